@@ -0,0 +1,59 @@
+#version 440
+
+// Expand one sprite per instance into a quad (see billboards.h). The
+// sprite's position and velocity are pulled from the particle buffers
+
+// Billboard modes (match billboards.h)
+#define BILLBOARD_FACING 0
+#define BILLBOARD_AXIS 1
+#define BILLBOARD_VELOCITY 2
+
+// Model-view transformation
+uniform mat4 MV;
+// The projection transformation
+uniform mat4 P;
+// How the quad is turned
+uniform int billboard_mode;
+// Half the width of a sprite
+uniform float billboard_size;
+// Axis the sprites turn about (model space)
+uniform vec3 billboard_axis;
+// Length added behind a sprite per unit of speed
+uniform float billboard_stretch;
+
+// SSBO bindings (match particle.comp)
+layout(std430, binding = 0) readonly buffer PositionBuffer { vec4 positions[]; };
+layout(std430, binding = 1) readonly buffer VelocityBuffer { vec4 velocities[]; };
+
+// Outgoing corner of the quad, -1 to 1 on each axis
+layout(location = 0) out vec2 corner;
+// Outgoing camera space centre of the sprite
+layout(location = 1) flat out vec3 centre;
+
+void main() {
+  // Corner of the strip - (-1,-1), (1,-1), (-1,1), (1,1)
+  corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;
+  centre = (MV * vec4(positions[gl_InstanceID].xyz, 1.0)).xyz;
+  // Camera facing - the quad lies in the view plane
+  vec3 side = vec3(1.0, 0.0, 0.0);
+  vec3 up = vec3(0.0, 1.0, 0.0);
+  float back = billboard_size;
+  if (billboard_mode == BILLBOARD_AXIS) {
+    // Up is the axis, side turns to face the camera around it
+    up = normalize(mat3(MV) * billboard_axis);
+    side = normalize(cross(up, centre));
+  } else if (billboard_mode == BILLBOARD_VELOCITY) {
+    // Up follows the velocity across the screen and the tail trails
+    // further behind the faster the sprite moves
+    vec3 velocity = mat3(MV) * velocities[gl_InstanceID].xyz;
+    if (dot(velocity.xy, velocity.xy) > 0.0) {
+      up = vec3(normalize(velocity.xy), 0.0);
+      side = vec3(up.y, -up.x, 0.0);
+      back += length(velocity) * billboard_stretch;
+    }
+  }
+  // Corners below the centre reach back along the tail
+  float along = corner.y > 0.0 ? corner.y * billboard_size : corner.y * back;
+  vec3 position = centre + side * corner.x * billboard_size + up * along;
+  gl_Position = P * vec4(position, 1.0);
+}
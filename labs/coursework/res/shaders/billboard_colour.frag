@@ -0,0 +1,18 @@
+#version 440
+
+// Colour of the sprites
+uniform vec4 colour;
+
+// Incoming corner of the quad
+layout(location = 0) in vec2 corner;
+
+// Outgoing colour
+layout(location = 0) out vec4 out_colour;
+
+void main() {
+  // Round sprites - drop the corners of the quad
+  if (dot(corner, corner) > 1.0) {
+    discard;
+  }
+  out_colour = colour;
+}
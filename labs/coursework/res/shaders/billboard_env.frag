@@ -0,0 +1,49 @@
+#version 440
+
+// Texture to use on billboards
+uniform samplerCube tex;
+// Half the width of the disk
+uniform float billboard_size;
+
+// Per-frame camera and fog data (see uniform_blocks.h)
+#ifndef FRAME_DATA
+#define FRAME_DATA
+layout(std140, binding = 0) uniform frame_data {
+  // Position of the active camera
+  vec3 eye_pos;
+  // Fog type
+  int fog_type;
+  // Fog colour
+  vec4 fog_colour;
+  // Fog start position
+  float fog_start;
+  // Fog end position
+  float fog_end;
+  // Fog density
+  float fog_density;
+};
+#endif
+
+// Incoming corner of the quad
+layout(location = 0) in vec2 corner;
+// Incoming camera space centre of the disk
+layout(location = 1) flat in vec3 centre;
+
+// Outgoing colour
+layout(location = 0) out vec4 colour;
+
+void main() {
+  // Disk cut from the quad
+  float r = length(corner);
+  if (r > 1.0) {
+    discard;
+  }
+  // Normal (faces camera)
+  vec3 normal = vec3(0.0, 0.0, 1.0);
+  // Environment map coordinate at the centre and on the rim, blended
+  // across the radius as the old triangle fan did
+  vec2 rim = centre.xy + (r > 0.0 ? corner / r : vec2(0.0, 1.0)) * billboard_size;
+  vec3 centre_coord = normalize(reflect(vec3(centre.xy, 0.0) - eye_pos, normal));
+  vec3 rim_coord = normalize(reflect(vec3(rim, 0.0) - vec3(0.0, 1.0, 0.0), normal));
+  colour = texture(tex, mix(centre_coord, rim_coord, r));
+}
@@ -1,17 +1,5 @@
 #version 440
 
-// Point light information
-#ifndef POINT_LIGHT
-#define POINT_LIGHT
-struct point_light {
-  vec4 light_colour;
-  vec3 position;
-  float constant;
-  float linear;
-  float quadratic;
-};
-#endif
-
 // A material structure
 #ifndef MATERIAL
 #define MATERIAL
@@ -23,18 +11,32 @@ struct material {
 };
 #endif
 
+// Per-frame camera and fog data (see uniform_blocks.h)
+#ifndef FRAME_DATA
+#define FRAME_DATA
+layout(std140, binding = 0) uniform frame_data {
+  // Position of the active camera
+  vec3 eye_pos;
+  // Fog type
+  int fog_type;
+  // Fog colour
+  vec4 fog_colour;
+  // Fog start position
+  float fog_start;
+  // Fog end position
+  float fog_end;
+  // Fog density
+  float fog_density;
+};
+#endif
+
 // Forward declarations of used functions
-vec4 calculate_point(in point_light point, in material mat, in vec3 position, in vec3 normal, in vec3 view_dir,
-                     in vec4 tex_colour);
+vec4 calculate_points(in material mat, in vec3 position, in vec3 normal, in vec3 view_dir, in vec4 tex_colour);
 vec3 calc_normal(in vec3 normal, in vec3 tangent, in vec3 binormal, in sampler2D normal_map, in vec2 tex_coord);
 
 
-// Point lights for the scene
-uniform point_light points[1];
 // Material for the object
 uniform material mat;
-// Eye position
-uniform vec3 eye_pos;
 // Sampler used to get texture colour
 uniform sampler2D tex;
 // Normal map to sample from
@@ -63,10 +65,7 @@ void main() {
 	// Calculate normal from normal map
 	vec3 new_normal = calc_normal(transformed_normal, tangent_out, binormal_out, normal_map, tex_coord_out);
 	// Sum point lights
-	for (int i = 0; i < 1; ++i)
-	{
-		colour += calculate_point(points[i], mat, vertex_position, new_normal, view_dir, tex_colour);
-	}
+	colour += calculate_points(mat, vertex_position, new_normal, view_dir, tex_colour);
 	// Set alpha to 1.0f
 	colour.a = 1.0f;
 	// Make cloudless areas transparent so Earth can be seen through gaps
@@ -0,0 +1,114 @@
+#version 440
+
+// A material structure
+#ifndef MATERIAL
+#define MATERIAL
+struct material {
+  vec4 emissive;
+  vec4 diffuse_reflection;
+  vec4 specular_reflection;
+  float shininess;
+};
+#endif
+
+// Per-frame camera and fog data (see uniform_blocks.h)
+#ifndef FRAME_DATA
+#define FRAME_DATA
+layout(std140, binding = 0) uniform frame_data {
+  // Position of the active camera
+  vec3 eye_pos;
+  // Fog type
+  int fog_type;
+  // Fog colour
+  vec4 fog_colour;
+  // Fog start position
+  float fog_start;
+  // Fog end position
+  float fog_end;
+  // Fog density
+  float fog_density;
+};
+#endif
+
+// Lights for the current pass (see clusters.h)
+#ifndef LIGHT_DATA
+#define LIGHT_DATA
+layout(std140, binding = 1) uniform light_data {
+  // Camera view, to find a position's depth
+  mat4 V;
+  // Inverse camera projection, used when the clusters are built
+  mat4 inverse_P;
+  // Clusters across, up and into the screen
+  ivec4 cluster_dims;
+  // Screen width and height, camera near and far planes
+  vec4 cluster_params;
+  // Number of point lights in use
+  int point_count;
+  // Number of spot lights in use
+  int spot_count;
+};
+#endif
+
+// Materials of the frame, indexed by the G-buffer's material id
+layout(std430, binding = 8) readonly buffer deferred_materials {
+  material materials[];
+};
+
+// Forward declarations of used functions
+vec4 calculate_points(in material mat, in vec3 position, in vec3 normal, in vec3 view_dir, in vec4 tex_colour);
+vec4 calculate_spots(in sampler2D shadow_map, in material mat, in vec3 position, in vec3 normal, in vec3 view_dir,
+                     in vec4 tex_colour);
+float calculate_fog(in float fog_coord, in vec4 fog_colour, in float fog_start, in float fog_end, in float fog_density,
+                    in int fog_type);
+
+// G-buffer (see deferred.h)
+uniform sampler2D gbuffer_colour;
+uniform sampler2D gbuffer_normal;
+uniform sampler2D gbuffer_albedo;
+uniform sampler2D gbuffer_fog;
+uniform sampler2D gbuffer_depth;
+// Screen back to world space
+uniform mat4 inverse_PV;
+// Shadow map to sample from
+layout(binding = 7) uniform sampler2D shadow_map;
+
+// Incoming texture coordinate
+layout(location = 0) in vec2 tex_coord;
+// Outgoing colour
+layout(location = 0) out vec4 colour;
+
+// Unfold an octahedral encoded normal
+vec3 decode_octahedral(in vec2 e) {
+  vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  if (n.z < 0.0) {
+    n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+  }
+  return normalize(n);
+}
+
+void main() {
+  float depth = texture(gbuffer_depth, tex_coord).x;
+  // Nothing was written here, leave what is behind
+  if (depth >= 1.0) {
+    discard;
+  }
+  // World position from the depth
+  vec4 world = inverse_PV * vec4(vec3(tex_coord, depth) * 2.0 - 1.0, 1.0);
+  vec3 position = world.xyz / world.w;
+  vec3 normal = decode_octahedral(texture(gbuffer_normal, tex_coord).xy);
+  vec4 albedo = texture(gbuffer_albedo, tex_coord);
+  material mat = materials[int(albedo.a * 255.0)];
+  vec3 view_dir = normalize(eye_pos - position);
+  vec4 tex_colour = vec4(albedo.rgb, 1.0);
+  // Unlit colour from the G-buffer pass plus every light
+  colour = texture(gbuffer_colour, tex_coord);
+  colour += calculate_points(mat, position, normal, view_dir, tex_colour);
+  colour += calculate_spots(shadow_map, mat, position, normal, view_dir, tex_colour);
+  // Fog the lit colour as the forward shaders do, by camera depth
+  if (texture(gbuffer_fog, tex_coord).x > 0.5) {
+    float fog_coord = abs((V * vec4(position, 1.0)).z);
+    float fog_factor = calculate_fog(fog_coord, fog_colour, fog_start, fog_end, fog_density, fog_type);
+    colour = mix(colour, fog_colour, fog_factor);
+  }
+  colour.a = 1.0;
+}
@@ -0,0 +1,7 @@
+#version 440
+
+// Only depth is written, colour writes are masked off
+
+void main()
+{
+}
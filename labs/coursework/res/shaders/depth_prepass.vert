@@ -0,0 +1,20 @@
+#version 440
+
+// Depth-only pass ahead of shading (see render_queue.h). Shaders
+// drawn against its depth with GL_EQUAL must declare gl_Position
+// invariant and compute it the same way
+
+// Model view projection matrix
+uniform mat4 MVP;
+
+// Incoming position
+layout (location = 0) in vec3 position;
+
+// Must match the shading pass exactly
+invariant gl_Position;
+
+void main()
+{
+	// Calculate screen position of vertex
+	gl_Position = MVP * vec4(position, 1.0);
+}
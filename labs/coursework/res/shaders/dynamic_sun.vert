@@ -0,0 +1,83 @@
+#version 440
+
+// Model view projection matrix
+uniform mat4 MVP;
+// MV transformation
+uniform mat4 MV;
+// The transformation matrix
+uniform mat4 M;
+// The normal matrix
+uniform mat3 N;
+// Explode factor (how much to deform the sun)
+uniform float explode_factor;
+// Peak factor (how much more to deform the active area)
+uniform float peak_factor;
+// Active position on sun surface
+uniform vec3 sun_activity;
+
+// Incoming position
+layout (location = 0) in vec3 position;
+// Incoming normal
+layout(location = 2) in vec3 normal;
+// Incoming binormal
+layout(location = 3) in vec3 binormal;
+// Incoming tangent
+layout(location = 4) in vec3 tangent;
+// Incoming texture coordinate
+layout (location = 10) in vec2 tex_coord_in;
+
+// Outgoing vertex position
+layout (location = 0) out vec3 vertex_position;
+// Outgoing texture coordinate
+layout (location = 1) out vec2 tex_coord_out;
+// Outgoing transformed normal
+layout(location = 2) out vec3 transformed_normal;
+// Incoming tangent
+layout(location = 3) out vec3 tangent_out;
+// Incoming binormal
+layout(location = 4) out vec3 binormal_out;
+// Camera space position
+layout(location = 6) out vec4 CS_position;
+
+// Picks roughly one vertex in three to push out. Hashing the position
+// rather than the vertex id means every triangle sharing a vertex
+// moves it the same way, so the surface never tears
+bool is_spike(in vec3 p)
+{
+	return fract(sin(dot(floor(p * 1000.0f), vec3(12.9898f, 78.233f, 45.164f))) * 43758.5453f) < 0.3333f;
+}
+
+void main()
+{
+	// Undeformed world position of vertex
+	vec3 world_position = vec3(M * vec4(position, 1.0f));
+	vec3 displaced = position;
+	// Deforming vertices at poles results in large spikes.
+	// Avoid deforming these
+	if (is_spike(position) && world_position.y < 8.0f && world_position.y > -8.0f)
+	{
+		// How far it moves from the surface depends on whether or not
+		// it is in an active area. If so, it moves out further
+		float amount = explode_factor;
+		if (distance(world_position, sun_activity) <= 2.0f)
+			amount *= peak_factor;
+		// Move out along the normal, the sun's scale is undone so the
+		// distance is in world units
+		float scale = max(length(M[0].xyz), 0.0001f);
+		displaced += normalize(normal) * amount / scale;
+	}
+	// Calculate screen position of vertex
+	gl_Position = MVP * vec4(displaced, 1.0f);
+	// Calculate world position of vertex
+	vertex_position = vec3(M * vec4(displaced, 1.0f));
+	// Calculate camera space position
+	CS_position = MV * vec4(displaced, 1.0);
+	// Pass through texture coord
+	tex_coord_out = tex_coord_in;
+	// Transform normal (reverse because point light is inside sun)
+	transformed_normal = -1.0f * N * normal;
+	// Transform tangent
+	tangent_out = N * tangent;
+	// Transform binormal
+	binormal_out = N * binormal;
+}
@@ -6,8 +6,6 @@ uniform mat4 MVP;
 uniform mat4 M;
 // The normal matrix
 uniform mat3 N;
-// The light transformation matrix
-uniform mat4 lightMVP;
 
 // Incoming position
 layout (location = 0) in vec3 position;
@@ -30,8 +28,9 @@ layout (location = 2) out vec3 transformed_normal;
 layout(location = 3) out vec3 tangent_out;
 // Outgoing binormal
 layout(location = 4) out vec3 binormal_out;
-// Outgoing position in light space
-layout (location = 5) out vec4 light_space_pos;
+
+// Must match the depth prepass exactly
+invariant gl_Position;
 
 void main()
 {
@@ -47,6 +46,4 @@ void main()
     binormal_out = N * binormal;
     // Pass through texture coordinate
     tex_coord_out = tex_coord_in;
-    // Transform position into light space
-	light_space_pos = lightMVP * vec4(position, 1.0);
 }
\ No newline at end of file
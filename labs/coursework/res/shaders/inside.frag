@@ -1,31 +1,5 @@
 #version 440
 
-// Point light information
-#ifndef POINT_LIGHT
-#define POINT_LIGHT
-struct point_light {
-  vec4 light_colour;
-  vec3 position;
-  float constant;
-  float linear;
-  float quadratic;
-};
-#endif
-
-// Spot light data
-#ifndef SPOT_LIGHT
-#define SPOT_LIGHT
-struct spot_light {
-  vec4 light_colour;
-  vec3 position;
-  vec3 direction;
-  float constant;
-  float linear;
-  float quadratic;
-  float power;
-};
-#endif
-
 // A material structure
 #ifndef MATERIAL
 #define MATERIAL
@@ -37,40 +11,41 @@ struct material {
 };
 #endif
 
+// Per-frame camera and fog data (see uniform_blocks.h)
+#ifndef FRAME_DATA
+#define FRAME_DATA
+layout(std140, binding = 0) uniform frame_data {
+  // Position of the active camera
+  vec3 eye_pos;
+  // Fog type
+  int fog_type;
+  // Fog colour
+  vec4 fog_colour;
+  // Fog start position
+  float fog_start;
+  // Fog end position
+  float fog_end;
+  // Fog density
+  float fog_density;
+};
+#endif
+
 // Forward declarations of used functions
-vec4 calculate_point(in point_light point, in material mat, in vec3 position, in vec3 normal, in vec3 view_dir,
+vec4 calculate_points(in material mat, in vec3 position, in vec3 normal, in vec3 view_dir, in vec4 tex_colour);
+vec4 calculate_spots(in sampler2D shadow_map, in material mat, in vec3 position, in vec3 normal, in vec3 view_dir,
                      in vec4 tex_colour);
-vec4 calculate_spot(in spot_light spot, in material mat, in vec3 position, in vec3 normal, in vec3 view_dir,
-                    in vec4 tex_colour);
-float calculate_shadow(in sampler2D shadow_map, in vec4 light_space_pos);
 vec3 calc_normal(in vec3 normal, in vec3 tangent, in vec3 binormal, in sampler2D normal_map, in vec2 tex_coord);
 float calculate_fog(in float fog_coord, in vec4 fog_colour, in float fog_start, in float fog_end, in float fog_density,
                     in int fog_type);
 
-// Point lights for the scene
-uniform point_light points[1];
-// Spot lights for the scene
-uniform spot_light spots[2];
 // Material for the object
 uniform material mat;
-// Eye position
-uniform vec3 eye_pos;
 // Texture
 uniform sampler2D tex;
 // Normal map to sample from
 uniform sampler2D normal_map;
 // Shadow map to sample from
-uniform sampler2D shadow_map;
-// Fog colour
-uniform vec4 fog_colour;
-// Fog start position
-uniform float fog_start;
-// Fog end position
-uniform float fog_end;
-// Fog density
-uniform float fog_density;
-// Fog type
-uniform int fog_type;
+layout(binding = 7) uniform sampler2D shadow_map;
 
 // Incoming position
 layout(location = 0) in vec3 vertex_position;
@@ -82,8 +57,6 @@ layout(location = 2) in vec3 transformed_normal;
 layout(location = 3) in vec3 tangent_out;
 // Incoming binormal
 layout(location = 4) in vec3 binormal_out;
-// Incoming light space position
-layout(location = 5) in vec4 light_space_pos;
 // Camera space position
 layout(location = 6) in vec4 CS_position;
 
@@ -91,8 +64,6 @@ layout(location = 6) in vec4 CS_position;
 layout(location = 0) out vec4 colour;
 
 void main() {
-	// Calculate shade factor
-	float shade = calculate_shadow(shadow_map, light_space_pos);
 	// Calculate view direction
 	vec3 view_dir = normalize(eye_pos - vertex_position);
 	// Sample texture
@@ -100,15 +71,9 @@ void main() {
 	// Calculate normal from normal map
 	vec3 new_normal = calc_normal(transformed_normal, tangent_out, binormal_out, normal_map, tex_coord_out);
 	// Sum point lights
-	for (int i = 0; i < 1; ++i)
-	{
-		colour += calculate_point(points[i], mat, vertex_position, new_normal, view_dir, tex_colour);
-	}
+	colour += calculate_points(mat, vertex_position, new_normal, view_dir, tex_colour);
 	// Sum spot lights (taking shadow into account)
-	for (int i = 0; i < 2; ++i)
-	{
-		colour += calculate_spot(spots[i], mat, vertex_position, new_normal, view_dir, tex_colour) * shade;
-	}
+	colour += calculate_spots(shadow_map, mat, vertex_position, new_normal, view_dir, tex_colour);
 	// Calculate fog coord
 	float fog_coord = abs(CS_position.z / CS_position.w);
 	// Calculate fog factor
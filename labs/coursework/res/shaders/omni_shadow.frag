@@ -0,0 +1,14 @@
+#version 440
+
+// Position of the light and the furthest distance stored
+uniform vec3 light_pos;
+uniform float far_plane;
+
+// Incoming world position
+layout(location = 0) in vec3 world_position;
+
+void main() {
+  // Store the distance to the light rather than the projected depth
+  // so every face can be compared the same way
+  gl_FragDepth = distance(world_position, light_pos) / far_plane;
+}
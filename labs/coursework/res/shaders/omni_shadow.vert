@@ -0,0 +1,12 @@
+#version 440
+
+// Model transformation matrix
+uniform mat4 M;
+
+// Incoming position
+layout(location = 0) in vec3 position;
+
+void main() {
+  // World position, each cube face projects it in the geometry shader
+  gl_Position = M * vec4(position, 1.0);
+}
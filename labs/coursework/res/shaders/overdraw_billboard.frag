@@ -0,0 +1,25 @@
+#version 440
+
+// Counts the fragments of round billboards into the overdraw image
+// (see overdraw.h and billboards.h)
+
+// Count only what passes the depth test, as the real shaders would
+layout(early_fragment_tests) in;
+
+// Fragments (or their cost) drawn to each pixel
+layout(binding = 0, r32ui) uniform coherent uimage2D overdraw_counts;
+// Amount to add for each fragment
+uniform int cost;
+
+// Incoming corner of the quad
+layout(location = 0) in vec2 corner;
+
+void main()
+{
+	// The corners the sprite shaders drop are not shaded
+	if (dot(corner, corner) > 1.0)
+	{
+		discard;
+	}
+	imageAtomicAdd(overdraw_counts, ivec2(gl_FragCoord.xy), uint(cost));
+}
@@ -0,0 +1,17 @@
+#version 440
+
+// Counts every fragment that survives the depth test into the
+// overdraw image (see overdraw.h)
+
+// Count only what passes the depth test, as the real shaders would
+layout(early_fragment_tests) in;
+
+// Fragments (or their cost) drawn to each pixel
+layout(binding = 0, r32ui) uniform coherent uimage2D overdraw_counts;
+// Amount to add for each fragment
+uniform int cost;
+
+void main()
+{
+	imageAtomicAdd(overdraw_counts, ivec2(gl_FragCoord.xy), uint(cost));
+}
@@ -0,0 +1,25 @@
+#version 440
+
+// Counting pass of the overdraw view (see overdraw.h), drawn in
+// place of every mesh effect
+
+// Model view projection matrix
+uniform mat4 MVP;
+// Push the draw to the far plane, as skybox.vert does
+uniform int far_plane;
+
+// Incoming position
+layout (location = 0) in vec3 position;
+
+// Must match the depth prepass exactly
+invariant gl_Position;
+
+void main()
+{
+	// Calculate screen position of vertex
+	gl_Position = MVP * vec4(position, 1.0);
+	if (far_plane != 0)
+	{
+		gl_Position = gl_Position.xyww;
+	}
+}
@@ -0,0 +1,27 @@
+#version 440
+
+// Shows the overdraw image as a heatmap (see overdraw.h) - black
+// where nothing was drawn, then blue through green and yellow to red
+
+// Fragments (or their cost) drawn to each pixel
+layout(binding = 0, r32ui) uniform readonly uimage2D overdraw_counts;
+// Count shown fully red
+uniform float max_count;
+
+// Incoming texture coordinate
+layout(location = 0) in vec2 tex_coord;
+// Outgoing colour
+layout(location = 0) out vec4 colour;
+
+// Colour ramp from 0 (blue) to 1 (red)
+vec3 heat(in float t)
+{
+	t = clamp(t, 0.0, 1.0);
+	return clamp(vec3(4.0 * t - 2.0, t < 0.5 ? 4.0 * t : 4.0 - 4.0 * t, 2.0 - 4.0 * t), 0.0, 1.0);
+}
+
+void main()
+{
+	uint count = imageLoad(overdraw_counts, ivec2(gl_FragCoord.xy)).x;
+	colour = vec4(count == 0 ? vec3(0.0) : heat(float(count) / max_count), 1.0);
+}
@@ -0,0 +1,65 @@
+
+// Lights for the current pass (see clusters.h)
+#ifndef LIGHT_DATA
+#define LIGHT_DATA
+layout(std140, binding = 1) uniform light_data {
+  // Camera view, to find a position's depth
+  mat4 V;
+  // Inverse camera projection, used when the clusters are built
+  mat4 inverse_P;
+  // Clusters across, up and into the screen
+  ivec4 cluster_dims;
+  // Screen width and height, camera near and far planes
+  vec4 cluster_params;
+  // Number of point lights in use
+  int point_count;
+  // Number of spot lights in use
+  int spot_count;
+};
+#endif
+
+// Lights each cluster can list (match clusters.h)
+#ifndef CLUSTER_MAX_POINTS
+#define CLUSTER_MAX_POINTS 64
+#define CLUSTER_MAX_SPOTS 32
+#endif
+
+// Number of point (x) and spot (y) lights in each cluster
+layout(std430, binding = 6) readonly buffer cluster_counts {
+  uvec2 counts[];
+};
+// Lights in each cluster, point lights then spot lights
+layout(std430, binding = 7) readonly buffer cluster_indices {
+  uint indices[];
+};
+
+// Cluster a fragment at a world position falls in
+int cluster_index(in vec3 position) {
+  // Slices get deeper further away, evenly spaced in log depth
+  float depth = max(-(V * vec4(position, 1.0)).z, cluster_params.z);
+  ivec3 cell;
+  cell.xy = ivec2(gl_FragCoord.xy / cluster_params.xy * vec2(cluster_dims.xy));
+  cell.z = int(log(depth / cluster_params.z) / log(cluster_params.w / cluster_params.z) * float(cluster_dims.z));
+  cell = clamp(cell, ivec3(0), cluster_dims.xyz - 1);
+  return (cell.z * cluster_dims.y + cell.y) * cluster_dims.x + cell.x;
+}
+
+// Number of point lights in a cluster
+uint cluster_point_count(in int cluster) {
+  return counts[cluster].x;
+}
+
+// Index of the ith point light in a cluster
+int cluster_point(in int cluster, in uint i) {
+  return int(indices[cluster * (CLUSTER_MAX_POINTS + CLUSTER_MAX_SPOTS) + i]);
+}
+
+// Number of spot lights in a cluster
+uint cluster_spot_count(in int cluster) {
+  return counts[cluster].y;
+}
+
+// Index of the ith spot light in a cluster
+int cluster_spot(in int cluster, in uint i) {
+  return int(indices[cluster * (CLUSTER_MAX_POINTS + CLUSTER_MAX_SPOTS) + CLUSTER_MAX_POINTS + i]);
+}
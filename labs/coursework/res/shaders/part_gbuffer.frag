@@ -0,0 +1,69 @@
+
+// Writes the surface into the G-buffer instead of lighting it (see
+// deferred.h). Lit effects built with this part in place of the
+// light and fog parts leave only their unlit colour in the first
+// target, the lighting pass adds the lights and then the fog
+
+// Material data
+#ifndef MATERIAL
+#define MATERIAL
+struct material
+{
+	vec4 emissive;
+	vec4 diffuse_reflection;
+	vec4 specular_reflection;
+	float shininess;
+};
+#endif
+
+// Entry of the frame's material table the object uses
+uniform int material_id;
+
+// Octahedral encoded normal
+layout(location = 1) out vec2 gbuffer_normal;
+// Albedo (rgb) and material id (a)
+layout(location = 2) out vec4 gbuffer_albedo;
+// 1 where the surface is fogged
+layout(location = 3) out float gbuffer_fog;
+
+// Fold a unit vector onto an octahedron and flatten it to -1..1
+vec2 encode_octahedral(in vec3 n)
+{
+	n /= abs(n.x) + abs(n.y) + abs(n.z);
+	vec2 folded = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	return n.z >= 0.0 ? n.xy : folded;
+}
+
+// Store everything the lighting pass needs
+void write_gbuffer(in vec3 normal, in vec4 tex_colour)
+{
+	gbuffer_normal = encode_octahedral(normalize(normal));
+	gbuffer_albedo = vec4(tex_colour.rgb, (float(material_id) + 0.5) / 255.0);
+	// Unfogged unless calculate_fog follows, as it does in every
+	// effect that fogs
+	gbuffer_fog = 0.0;
+}
+
+// Point lights are added by the lighting pass
+vec4 calculate_points(in material mat, in vec3 position, in vec3 normal, in vec3 view_dir, in vec4 tex_colour)
+{
+	write_gbuffer(normal, tex_colour);
+	return vec4(0.0);
+}
+
+// Spot lights are added by the lighting pass
+vec4 calculate_spots(in sampler2D shadow_map, in material mat, in vec3 position, in vec3 normal, in vec3 view_dir,
+                     in vec4 tex_colour)
+{
+	write_gbuffer(normal, tex_colour);
+	return vec4(0.0);
+}
+
+// Fog is applied by the lighting pass once the lights are summed,
+// here the surface is only marked and left unfogged
+float calculate_fog(in float fog_coord, in vec4 fog_colour, in float fog_start, in float fog_end, in float fog_density,
+                    in int fog_type)
+{
+	gbuffer_fog = 1.0;
+	return 0.0;
+}
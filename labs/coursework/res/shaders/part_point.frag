@@ -9,6 +9,7 @@ struct point_light
 	float constant;
 	float linear;
 	float quadratic;
+	float range;
 };
 #endif
 
@@ -24,6 +25,20 @@ struct material
 };
 #endif
 
+// Point lights of the current pass (see clusters.h)
+#ifndef POINT_LIGHTS
+#define POINT_LIGHTS
+layout(std430, binding = 4) readonly buffer point_lights {
+	point_light points[];
+};
+#endif
+
+// Forward declarations of used functions
+int cluster_index(in vec3 position);
+uint cluster_point_count(in int cluster);
+int cluster_point(in int cluster, in uint i);
+float calculate_point_shadow(in int point, in vec3 position);
+
 // Point light calculation
 vec4 calculate_point(in point_light point, in material mat, in vec3 position, in vec3 normal, in vec3 view_dir, in vec4 tex_colour)
 {
@@ -48,4 +63,18 @@ vec4 calculate_point(in point_light point, in material mat, in vec3 position, in
 	vec4 colour = primary * tex_colour + specular;
 	colour.a = 1.0;
 	return colour;
-}
\ No newline at end of file
+}
+
+// Sum of the point lights in a position's cluster
+vec4 calculate_points(in material mat, in vec3 position, in vec3 normal, in vec3 view_dir, in vec4 tex_colour)
+{
+	vec4 colour = vec4(0.0);
+	int cluster = cluster_index(position);
+	uint count = cluster_point_count(cluster);
+	for (uint i = 0; i < count; ++i)
+	{
+		int index = cluster_point(cluster, i);
+		colour += calculate_point(points[index], mat, position, normal, view_dir, tex_colour) * calculate_point_shadow(index, position);
+	}
+	return colour;
+}
@@ -1,28 +1,162 @@
 
-// Calculates the shadow factor of a vertex
-float calculate_shadow(in sampler2D shadow_map, in vec4 light_space_pos) {
-  // Get light screen space coordinate
+// Shadowed lights for the current pass (see shadow_atlas.h, cascades.h and omni_shadow.h)
+#ifndef MAX_SPOT_LIGHTS
+#define MAX_SPOT_LIGHTS 4
+#endif
+#ifndef MAX_CASCADES
+#define MAX_CASCADES 4
+#endif
+#ifndef SHADOW_FILTER_HARD
+#define SHADOW_FILTER_HARD 0
+#define SHADOW_FILTER_VSM 1
+#define SHADOW_FILTER_ESM 2
+#endif
+#ifndef SHADOW_DATA
+#define SHADOW_DATA
+layout(std140, binding = 2) uniform shadow_data {
+  // World to atlas texture space of each spot light
+  mat4 shadow_matrices[MAX_SPOT_LIGHTS];
+  // Atlas tile of each spot light (min xy, max xy), empty if it casts no shadow
+  vec4 shadow_rects[MAX_SPOT_LIGHTS];
+  // World to texture space of each cascade, nearest first
+  mat4 cascade_matrices[MAX_CASCADES];
+  // Spot light shadowed by the cascades, -1 for none
+  int cascade_spot;
+  // Number of cascades in use
+  int cascade_count;
+  // Point light shadowed by the cube map, -1 for none
+  int omni_point;
+  // Position of that point light (xyz) and its shadow's far distance (w)
+  vec4 omni_light;
+  // How the cascades are filtered (see shadow_filter.h)
+  int filter_mode;
+  // Sharpness of exponential shadows
+  float filter_exponent;
+  // Near and far planes of the cascaded light
+  float light_near;
+  float light_far;
+};
+#endif
+
+// Cascades of the main spot light
+layout(binding = 8) uniform sampler2DArray cascade_map;
+// Distances to the nearest caster around the shadowed point light
+layout(binding = 9) uniform samplerCube omni_map;
+// Blurred and mipmapped moments of the cascades
+layout(binding = 10) uniform sampler2DArray moments_map;
+
+// Shadow factor from a stored depth and the depth being lit
+float compare_depth(in float depth, in float z) {
+  // Check if depth is in range.  Add a slight epsilon for precision
+  if (depth == 0.0) {
+    return 1.0;
+  } else if (depth < z + 0.001) {
+    return 0.5;
+  } else {
+    return 1.0;
+  }
+}
+
+// Projected depth to linear 0..1 between the cascaded light's planes
+float linear_shadow_depth(in float z) {
+  float ndc = 2.0 * z - 1.0;
+  float view_z = 2.0 * light_near * light_far / (light_far + light_near - ndc * (light_far - light_near));
+  return (view_z - light_near) / (light_far - light_near);
+}
+
+// Shadow factor from the prefiltered moments of a cascade. The
+// gradients are worked out before any branching so the mip level
+// is right
+float filtered_shadow(in vec3 coords, in vec2 ddx, in vec2 ddy, in float z) {
+  vec2 moments = textureGrad(moments_map, coords, ddx, ddy).xy;
+  float depth = linear_shadow_depth(z);
+  float lit;
+  if (filter_mode == SHADOW_FILTER_ESM) {
+    // exp(c * occluder) * exp(-c * receiver) falls off behind casters
+    lit = clamp(moments.x * exp(-filter_exponent * depth), 0.0, 1.0);
+  } else {
+    // Chebyshev's upper bound on the lit fraction
+    float variance = max(moments.y - moments.x * moments.x, 0.00002);
+    float d = depth - moments.x;
+    float p_max = depth <= moments.x ? 1.0 : variance / (variance + d * d);
+    // Cut off the tail to reduce light bleeding
+    lit = clamp((p_max - 0.2) / 0.8, 0.0, 1.0);
+  }
+  // Same range as the hard compare
+  return mix(0.5, 1.0, lit);
+}
+
+// Shadow factor from the nearest cascade that covers a position
+float calculate_cascade_shadow(in vec3 position) {
+  // Screen space change in position for the filtered lookups
+  vec3 dx = dFdx(position);
+  vec3 dy = dFdy(position);
+  for (int c = 0; c < cascade_count; ++c) {
+    vec4 light_space_pos = cascade_matrices[c] * vec4(position, 1.0);
+    if (light_space_pos.w <= 0.0) {
+      continue;
+    }
+    vec3 proj_coords = light_space_pos.xyz / light_space_pos.w;
+    // Cascades are tighter nearer the camera, use the first that fits
+    if (all(greaterThanEqual(proj_coords.xy, vec2(0.0))) && all(lessThanEqual(proj_coords.xy, vec2(1.0)))) {
+      if (filter_mode == SHADOW_FILTER_HARD) {
+        return compare_depth(texture(cascade_map, vec3(proj_coords.xy, c)).x, proj_coords.z);
+      }
+      // Texture space gradients of this cascade
+      vec4 pos_x = cascade_matrices[c] * vec4(position + dx, 1.0);
+      vec4 pos_y = cascade_matrices[c] * vec4(position + dy, 1.0);
+      vec2 ddx = pos_x.xy / pos_x.w - proj_coords.xy;
+      vec2 ddy = pos_y.xy / pos_y.w - proj_coords.xy;
+      return filtered_shadow(vec3(proj_coords.xy, c), ddx, ddy, proj_coords.z);
+    }
+  }
+  return 1.0;
+}
+
+// Calculates the shadow factor of a position for a spot light
+float calculate_shadow(in sampler2D shadow_map, in int spot, in vec3 position) {
+  if (spot == cascade_spot) {
+    return calculate_cascade_shadow(position);
+  }
+  // Only the first lights of a pass have shadow slots
+  if (spot >= MAX_SPOT_LIGHTS) {
+    return 1.0;
+  }
+  vec4 rect = shadow_rects[spot];
+  // Lights without a tile cast no shadow
+  if (rect.z <= rect.x) {
+    return 1.0;
+  }
+  // Get light screen space coordinate, already mapped into the atlas
+  vec4 light_space_pos = shadow_matrices[spot] * vec4(position, 1.0);
+  if (light_space_pos.w <= 0.0) {
+    return 1.0;
+  }
   vec3 proj_coords = light_space_pos.xyz / light_space_pos.w;
-  // Use this to calculate texture coordinates for shadow map
-  vec2 shadow_tex_coords;
-  // This is a bias calculation to convert to texture space
-  shadow_tex_coords.x = 0.5 * proj_coords.x + 0.5;
-  shadow_tex_coords.y = 0.5 * proj_coords.y + 0.5;
-  // Check shadow coord is in range
-  if (shadow_tex_coords.x < 0 || shadow_tex_coords.x > 1 || shadow_tex_coords.y < 0 || shadow_tex_coords.y > 1) {
+  // Check shadow coord is in the light's tile
+  if (proj_coords.x < rect.x || proj_coords.x > rect.z || proj_coords.y < rect.y || proj_coords.y > rect.w) {
     return 1.0;
   }
-  float z = 0.5 * proj_coords.z + 0.5;
   // *********************************
   // Now sample the shadow map, return only first component (.x/.r)
-  float depth = texture(shadow_map, shadow_tex_coords).x;
+  float depth = texture(shadow_map, proj_coords.xy).x;
   // *********************************
-  // Check if depth is in range.  Add a slight epsilon for precision
-  if (depth == 0.0) {
+  return compare_depth(depth, proj_coords.z);
+}
+
+// Calculates the shadow factor of a position for a point light
+float calculate_point_shadow(in int point, in vec3 position) {
+  if (point != omni_point) {
     return 1.0;
-  } else if (depth < z + 0.001) {
-    return 0.5;
-  } else {
+  }
+  vec3 to_position = position - omni_light.xyz;
+  float dist = length(to_position);
+  // Beyond the far distance nothing was rendered
+  if (dist >= omni_light.w) {
     return 1.0;
   }
-}
\ No newline at end of file
+  // Stored distance is scaled to 0..1 by the far distance
+  float nearest = texture(omni_map, to_position).x * omni_light.w;
+  // Bias grows with distance as the texels get larger
+  return nearest < dist - max(0.05, dist * 0.01) ? 0.5 : 1.0;
+}
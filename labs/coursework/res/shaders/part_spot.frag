@@ -10,6 +10,7 @@ struct spot_light
 	float linear;
 	float quadratic;
 	float power;
+	float range;
 };
 #endif
 
@@ -25,6 +26,20 @@ struct material
 };
 #endif
 
+// Spot lights of the current pass (see clusters.h)
+#ifndef SPOT_LIGHTS
+#define SPOT_LIGHTS
+layout(std430, binding = 5) readonly buffer spot_lights {
+	spot_light spots[];
+};
+#endif
+
+// Forward declarations of used functions
+int cluster_index(in vec3 position);
+uint cluster_spot_count(in int cluster);
+int cluster_spot(in int cluster, in uint i);
+float calculate_shadow(in sampler2D shadow_map, in int spot, in vec3 position);
+
 // Spot light calculation
 vec4 calculate_spot(in spot_light spot, in material mat, in vec3 position, in vec3 normal, in vec3 view_dir, in vec4 tex_colour)
 {
@@ -49,4 +64,19 @@ vec4 calculate_spot(in spot_light spot, in material mat, in vec3 position, in ve
 	colour.a = 1.0;
 
 	return colour;
-}
\ No newline at end of file
+}
+
+// Sum of the spot lights in a position's cluster, taking shadow into account
+vec4 calculate_spots(in sampler2D shadow_map, in material mat, in vec3 position, in vec3 normal, in vec3 view_dir,
+                     in vec4 tex_colour)
+{
+	vec4 colour = vec4(0.0);
+	int cluster = cluster_index(position);
+	uint count = cluster_spot_count(cluster);
+	for (uint i = 0; i < count; ++i)
+	{
+		int index = cluster_spot(cluster, i);
+		colour += calculate_spot(spots[index], mat, position, normal, view_dir, tex_colour) * calculate_shadow(shadow_map, index, position);
+	}
+	return colour;
+}
@@ -0,0 +1,87 @@
+#version 440
+
+// A material structure
+#ifndef MATERIAL
+#define MATERIAL
+struct material {
+  vec4 emissive;
+  vec4 diffuse_reflection;
+  vec4 specular_reflection;
+  float shininess;
+};
+#endif
+
+// Per-frame camera and fog data (see uniform_blocks.h)
+#ifndef FRAME_DATA
+#define FRAME_DATA
+layout(std140, binding = 0) uniform frame_data {
+  // Position of the active camera
+  vec3 eye_pos;
+  // Fog type
+  int fog_type;
+  // Fog colour
+  vec4 fog_colour;
+  // Fog start position
+  float fog_start;
+  // Fog end position
+  float fog_end;
+  // Fog density
+  float fog_density;
+};
+#endif
+
+// Material of each instance (see instancing.h)
+struct planet_material {
+  vec4 emissive;
+  vec4 diffuse_reflection;
+  vec4 specular_reflection;
+  float shininess;
+};
+
+// Materials of the instances being drawn
+layout(std430, binding = 3) readonly buffer planet_materials {
+  planet_material materials[];
+};
+
+// Forward declarations of used functions
+vec4 calculate_points(in material mat, in vec3 position, in vec3 normal, in vec3 view_dir, in vec4 tex_colour);
+vec4 calculate_spots(in sampler2D shadow_map, in material mat, in vec3 position, in vec3 normal, in vec3 view_dir,
+                     in vec4 tex_colour);
+
+// Textures, one layer per material
+layout(binding = 0) uniform sampler2DArray tex;
+// Shadow map to sample from
+layout(binding = 7) uniform sampler2D shadow_map;
+
+// Incoming position
+layout(location = 0) in vec3 vertex_position;
+// Incoming texture coordinate
+layout(location = 1) in vec2 tex_coord_out;
+// Incoming normal
+layout(location = 2) in vec3 transformed_normal;
+// Incoming tangent
+layout(location = 3) in vec3 tangent_out;
+// Incoming binormal
+layout(location = 4) in vec3 binormal_out;
+// Incoming material and texture layer
+layout(location = 7) flat in uint material_in;
+
+// Outgoing colour
+layout(location = 0) out vec4 colour;
+
+void main() {
+	colour = vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	// Material of this instance
+	planet_material m = materials[material_in];
+	material mat = material(m.emissive, m.diffuse_reflection, m.specular_reflection, m.shininess);
+	// Calculate view direction
+	vec3 view_dir = normalize(eye_pos - vertex_position);
+	// Sample texture
+	vec4 tex_colour = texture(tex, vec3(tex_coord_out, float(material_in)));
+	// Sum point lights
+	colour += calculate_points(mat, vertex_position, transformed_normal, view_dir, tex_colour);
+	// Sum spot lights (taking shadow into account)
+	colour += calculate_spots(shadow_map, mat, vertex_position, transformed_normal, view_dir, tex_colour);
+	// Set alpha to 1.0f
+	colour.a = 1.0f;
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+#version 440
+
+// Per-instance data (see instancing.h)
+struct planet_instance {
+  // The transformation matrix
+  mat4 M;
+  // Model view projection matrix
+  mat4 MVP;
+  // The normal matrix (upper 3x3)
+  mat4 N;
+  // Material and texture layer
+  uint material;
+};
+
+// Instances being drawn
+layout(std430, binding = 2) readonly buffer planet_instances {
+  planet_instance instances[];
+};
+
+// First instance of this draw in the buffer - at a fixed location
+// so the overdraw view's counting effect can share the batch's draw
+layout(location = 0) uniform int instance_offset;
+
+// Incoming position
+layout (location = 0) in vec3 position;
+// Incoming normal
+layout(location = 2) in vec3 normal;
+// Incoming binormal
+layout(location = 3) in vec3 binormal;
+// Incoming tangent
+layout(location = 4) in vec3 tangent;
+// Incoming texture coordinate
+layout (location = 10) in vec2 tex_coord_in;
+
+// Outgoing vertex position
+layout (location = 0) out vec3 vertex_position;
+// Outgoing texture coordinate
+layout (location = 1) out vec2 tex_coord_out;
+// Outgoing transformed normal
+layout(location = 2) out vec3 transformed_normal;
+// Outgoing tangent
+layout(location = 3) out vec3 tangent_out;
+// Outgoing binormal
+layout(location = 4) out vec3 binormal_out;
+// Outgoing material and texture layer
+layout (location = 7) flat out uint material_out;
+
+// Must match the depth prepass exactly
+invariant gl_Position;
+
+void main()
+{
+	planet_instance inst = instances[instance_offset + gl_InstanceID];
+	mat3 N = mat3(inst.N);
+	// Calculate screen position of vertex
+	gl_Position = inst.MVP * vec4(position, 1.0f);
+	// Calculate world position of vertex
+	vertex_position = vec3(inst.M * vec4(position, 1.0f));
+	// Pass texture coord
+	tex_coord_out = tex_coord_in;
+	// Transform normal
+	transformed_normal = N * normal;
+	// Transform tangent
+	tangent_out = N * tangent;
+	// Transform binormal
+	binormal_out = N * binormal;
+	// Pass material
+	material_out = inst.material;
+}
@@ -11,8 +11,9 @@ layout (location = 0) out vec3 tex_coord;
 
 void main()
 {
-	// Calculate screen space position
-	gl_Position = MVP * vec4(position, 1.0);
+	// Calculate screen space position, pushed to the far plane so
+	// the skybox only fills what nothing else covered
+	gl_Position = (MVP * vec4(position, 1.0)).xyww;
 	// Set outgoing texture coordinate
 	tex_coord = position;
 }
\ No newline at end of file
@@ -8,8 +8,6 @@ uniform mat4 MV;
 uniform mat4 M;
 // The normal matrix
 uniform mat3 N;
-// The light transformation matrix
-uniform mat4 lightMVP;
 
 // Incoming position
 layout (location = 0) in vec3 position;
@@ -32,8 +30,6 @@ layout(location = 2) out vec3 transformed_normal;
 layout(location = 3) out vec3 tangent_out;
 // Incoming binormal
 layout(location = 4) out vec3 binormal_out;
-// Outgoing position in light space
-layout (location = 5) out vec4 light_space_pos;
 // Camera space position
 layout(location = 6) out vec4 CS_position;
 
@@ -53,6 +49,4 @@ void main()
 	tangent_out = N * tangent;
 	// Transform binormal
 	binormal_out = N * binormal;
-    // Transform position into light space
-	light_space_pos = lightMVP * vec4(position, 1.0f);
 }
\ No newline at end of file
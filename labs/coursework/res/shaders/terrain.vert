@@ -8,8 +8,6 @@ uniform mat4 MV;
 uniform mat4 M;
 // N transformation matrix
 uniform mat3 N;
-// The light transformation matrix
-uniform mat4 lightMVP;
 
 // Incoming position
 layout(location = 0) in vec3 position;
@@ -28,11 +26,12 @@ layout(location = 1) out vec3 transformed_normal;
 layout(location = 2) out vec2 vertex_tex_coord;
 // Outgoing tex_weight
 layout(location = 3) out vec4 vertex_tex_weight;
-// Outgoing light space position
-layout(location = 5) out vec4 light_space_pos;
 // Outgoing camera space position
 layout(location = 6) out vec4 CS_position;
 
+// Must match the depth prepass exactly
+invariant gl_Position;
+
 void main() {
   // Calculate screen position
   gl_Position = MVP * vec4(position, 1.0);
@@ -46,6 +45,4 @@ void main() {
   vertex_tex_coord = tex_coord;
   // Pass through tex_weight
   vertex_tex_weight = tex_weight;
-  // Transform position into light space
-  light_space_pos = lightMVP * vec4(position, 1.0f);
 }
\ No newline at end of file
@@ -1,31 +1,5 @@
 #version 440
 
-// Point light information
-#ifndef POINT_LIGHT
-#define POINT_LIGHT
-struct point_light {
-  vec4 light_colour;
-  vec3 position;
-  float constant;
-  float linear;
-  float quadratic;
-};
-#endif
-
-// Spot light data
-#ifndef SPOT_LIGHT
-#define SPOT_LIGHT
-struct spot_light {
-  vec4 light_colour;
-  vec3 position;
-  vec3 direction;
-  float constant;
-  float linear;
-  float quadratic;
-  float power;
-};
-#endif
-
 // A material structure
 #ifndef MATERIAL
 #define MATERIAL
@@ -37,25 +11,36 @@ struct material {
 };
 #endif
 
+// Per-frame camera and fog data (see uniform_blocks.h)
+#ifndef FRAME_DATA
+#define FRAME_DATA
+layout(std140, binding = 0) uniform frame_data {
+  // Position of the active camera
+  vec3 eye_pos;
+  // Fog type
+  int fog_type;
+  // Fog colour
+  vec4 fog_colour;
+  // Fog start position
+  float fog_start;
+  // Fog end position
+  float fog_end;
+  // Fog density
+  float fog_density;
+};
+#endif
+
 // Forward declarations of used functions
-vec4 calculate_point(in point_light point, in material mat, in vec3 position, in vec3 normal, in vec3 view_dir,
+vec4 calculate_points(in material mat, in vec3 position, in vec3 normal, in vec3 view_dir, in vec4 tex_colour);
+vec4 calculate_spots(in sampler2D shadow_map, in material mat, in vec3 position, in vec3 normal, in vec3 view_dir,
                      in vec4 tex_colour);
-vec4 calculate_spot(in spot_light spot, in material mat, in vec3 position, in vec3 normal, in vec3 view_dir,
-                    in vec4 tex_colour);
-float calculate_shadow(in sampler2D shadow_map, in vec4 light_space_pos);
 
-// Point lights for the scene
-uniform point_light points[1];
-// Spot lights for the scene
-uniform spot_light spots[1];
 // Material for the object
 uniform material mat;
-// Eye position
-uniform vec3 eye_pos;
 // Texture
 uniform sampler2D tex[2];
 // Shadow map to sample from
-uniform sampler2D shadow_map;
+layout(binding = 7) uniform sampler2D shadow_map;
 
 // Incoming position
 layout(location = 0) in vec3 vertex_position;
@@ -63,15 +48,11 @@ layout(location = 0) in vec3 vertex_position;
 layout(location = 1) in vec2 tex_coord_out;
 // Incoming normal
 layout(location = 2) in vec3 transformed_normal;
-// Incoming light space position
-layout(location = 5) in vec4 light_space_pos;
 
 // Outgoing colour
 layout(location = 0) out vec4 colour;
 
 void main() {
-	// Calculate shade factor
-	float shade = calculate_shadow(shadow_map, light_space_pos);
 	// Calculate view direction
 	vec3 view_dir = normalize(eye_pos - vertex_position);
 	// Sample texture 1
@@ -83,15 +64,9 @@ void main() {
 	vec4 tex_colour = mix(tex_colour1, tex_colour2, 0.5);
 
 	// Sum point lights
-	for (int i = 0; i < 1; ++i)
-	{
-		colour += calculate_point(points[i], mat, vertex_position, transformed_normal, view_dir, tex_colour);
-	}
+	colour += calculate_points(mat, vertex_position, transformed_normal, view_dir, tex_colour);
 	// Sum spot lights (taking shadow into account)
-	for (int i = 0; i < 1; ++i)
-	{
-		colour += calculate_spot(spots[i], mat, vertex_position, transformed_normal, view_dir, tex_colour) * shade;
-	}
+	colour += calculate_spots(shadow_map, mat, vertex_position, transformed_normal, view_dir, tex_colour);
 	// Set alpha to 1.0f
 	colour.a = 1.0f;
 }
\ No newline at end of file
@@ -6,8 +6,6 @@ uniform mat4 MVP;
 uniform mat4 M;
 // The normal matrix
 uniform mat3 N;
-// The light transformation matrix
-uniform mat4 lightMVP;
 
 // Incoming position
 layout (location = 0) in vec3 position;
@@ -22,8 +20,9 @@ layout (location = 0) out vec3 vertex_position;
 layout (location = 1) out vec2 tex_coord_out;
 // Outgoing transformed normal
 layout(location = 2) out vec3 transformed_normal;
-// Outgoing position in light space
-layout (location = 5) out vec4 light_space_pos;
+
+// Must match the depth prepass exactly
+invariant gl_Position;
 
 void main()
 {
@@ -35,6 +34,4 @@ void main()
 	tex_coord_out = tex_coord_in;
 	// Transform normal
 	transformed_normal = N * normal;
-    // Transform position into light space
-	light_space_pos = lightMVP * vec4(position, 1.0f);
 }
\ No newline at end of file
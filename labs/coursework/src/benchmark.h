@@ -0,0 +1,250 @@
+// benchmark.h - Header file containing the benchmark mode
+// Functions to parse the benchmark command line, create a
+// hidden offscreen context, drive the scripted camera
+// flythrough and record per-frame CPU and GPU timings
+// Last modified - 18/10/2026
+
+#pragma once
+
+#include <glm\glm.hpp>
+#include <graphics_framework.h>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+
+using namespace std;
+using namespace std::chrono;
+using namespace graphics_framework;
+using namespace glm;
+
+// Context APIs the benchmark can render offscreen through
+#define BENCHMARK_CONTEXT_OSMESA 0
+#define BENCHMARK_CONTEXT_EGL 1
+
+// Benchmark settings and recorded timings
+struct benchmark_state
+{
+	// Is the benchmark running
+	bool active = false;
+	// Number of frames to render before exiting
+	unsigned int frame_count = 1000;
+	// Fixed time step used instead of the measured delta_time
+	float fixed_delta_time = 1.0f / 60.0f;
+	// Seed for every random generator in the scene
+	unsigned int seed = 8116;
+	// Context API used for the hidden window
+	int context = BENCHMARK_CONTEXT_OSMESA;
+	// File the timings are written to
+	string output = "benchmark.json";
+	// Shade through the G-buffer rather than forward
+	bool deferred = false;
+	// Lay down opaque depth before shading
+	bool prepass = false;
+	// Frames rendered so far
+	unsigned int frames_rendered = 0;
+	// Per-frame CPU timings in milliseconds
+	vector<double> cpu_update_ms;
+	vector<double> cpu_render_ms;
+	// Per-frame GPU timer queries
+	vector<GLuint> gpu_queries;
+	// Start points of the current update and render
+	high_resolution_clock::time_point update_start;
+	high_resolution_clock::time_point render_start;
+};
+
+// Read the benchmark options from the command line
+// Usage: coursework --benchmark [--frames N] [--dt seconds] [--seed S] [--out file.json] [--egl] [--deferred] [--prepass]
+void parse_benchmark_args(benchmark_state &bench, int argc, char *argv[])
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		string arg = argv[i];
+		// Options with a value must have one following them
+		bool has_value = i + 1 < argc;
+		if (arg == "--benchmark")
+			bench.active = true;
+		else if (arg == "--frames" && has_value)
+			bench.frame_count = std::max(1, atoi(argv[++i]));
+		else if (arg == "--dt" && has_value)
+			bench.fixed_delta_time = static_cast<float>(atof(argv[++i]));
+		else if (arg == "--seed" && has_value)
+			bench.seed = static_cast<unsigned int>(atoi(argv[++i]));
+		else if (arg == "--out" && has_value)
+			bench.output = argv[++i];
+		else if (arg == "--egl")
+			bench.context = BENCHMARK_CONTEXT_EGL;
+		else if (arg == "--osmesa")
+			bench.context = BENCHMARK_CONTEXT_OSMESA;
+		else if (arg == "--deferred")
+			bench.deferred = true;
+		else if (arg == "--prepass")
+			bench.prepass = true;
+	}
+}
+
+// Initialise GLFW for a hidden, displayless window before the
+// framework creates it. glfwInit is a no-op once initialised, so
+// the hints set here survive the framework's own initialisation.
+// The render nodes have no display, so this needs the null
+// platform of GLFW 3.4, which CMakeLists.txt puts in the framework.
+// Rather than quietly opening a normal window it fails without it
+bool init_benchmark_context(const benchmark_state &bench)
+{
+#if defined(GLFW_PLATFORM_NULL) && defined(GLFW_OSMESA_CONTEXT_API) && defined(GLFW_EGL_CONTEXT_API)
+	// Say why the context could not be made, such as no libOSMesa
+	glfwSetErrorCallback([](int code, const char *description) { cerr << "GLFW: " << description << endl; });
+	if (!glfwPlatformSupported(GLFW_PLATFORM_NULL))
+	{
+		cerr << "Benchmark: this GLFW was built without the null platform" << endl;
+		return false;
+	}
+	// No display on the render nodes - use the null platform
+	glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+	if (!glfwInit())
+	{
+		cerr << "Benchmark: could not initialise GLFW" << endl;
+		return false;
+	}
+	// Never show the window
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	// Choose the offscreen context API
+	if (bench.context == BENCHMARK_CONTEXT_OSMESA)
+		glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+	else
+		glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+	return true;
+#else
+	cerr << "Benchmark: needs GLFW 3.4 or later for a displayless OSMesa or EGL context" << endl;
+	return false;
+#endif
+}
+
+// Allocate the timing storage once the GL context exists
+void load_benchmark(benchmark_state &bench)
+{
+	bench.cpu_update_ms.assign(bench.frame_count, 0.0);
+	bench.cpu_render_ms.assign(bench.frame_count, 0.0);
+	bench.gpu_queries.resize(bench.frame_count);
+	glGenQueries(bench.frame_count, &bench.gpu_queries[0]);
+}
+
+// Drive the cameras along the scripted flythrough
+// The run is split into three equal legs: the target camera visits
+// its four preset positions, the free camera flies a curve through
+// the inner planets and the chase camera follows Earth then Jupiter
+void benchmark_camera_path(const benchmark_state &bench,
+						   bool &chase_camera_active, bool &free_camera_active,
+						   target_camera &tcam, free_camera &fcam, chase_camera &ccam,
+						   string &target)
+{
+	// Frame within the run and length of each leg
+	unsigned int frame = bench.frames_rendered;
+	unsigned int leg = std::max(1u, bench.frame_count / 3);
+	// Preset positions of the target camera
+	static const vec3 presets[] = { vec3(50.0f, 10.0f, 50.0f), vec3(-50.0f, 10.0f, 50.0f),
+									vec3(-50.0f, 10.0f, -50.0f), vec3(50.0f, 10.0f, -50.0f) };
+	// TARGET CAMERA
+	if (frame < leg)
+	{
+		chase_camera_active = false;
+		free_camera_active = false;
+		tcam.set_position(presets[(4 * frame / leg) % 4]);
+	}
+	// FREE CAMERA
+	else if (frame < 2 * leg)
+	{
+		chase_camera_active = false;
+		free_camera_active = true;
+		// Start the leg from the same place as a user would
+		if (frame == leg)
+		{
+			fcam.set_position(vec3(50.0f, 10.0f, 50.0f));
+			fcam.set_target(vec3(0.0f, 0.0f, 0.0f));
+		}
+		// Fly forward while turning slowly
+		fcam.rotate(0.002f, 0.0f);
+		fcam.move(vec3(0.0f, 0.0f, 0.1f));
+	}
+	// CHASE CAMERA
+	else
+	{
+		chase_camera_active = true;
+		free_camera_active = false;
+		// Follow Earth for the first half of the leg, then Jupiter
+		target = frame < leg * 5 / 2 ? "earth" : "jupiter";
+		// Circle the target
+		ccam.rotate(vec3(0.0f, 0.005f, 0.0f));
+	}
+}
+
+// Mark the start of the CPU update
+void benchmark_begin_update(benchmark_state &bench)
+{
+	bench.update_start = high_resolution_clock::now();
+}
+
+// Record the CPU update time
+void benchmark_end_update(benchmark_state &bench)
+{
+	if (bench.frames_rendered < bench.frame_count)
+	{
+		duration<double, milli> elapsed = high_resolution_clock::now() - bench.update_start;
+		bench.cpu_update_ms[bench.frames_rendered] = elapsed.count();
+	}
+}
+
+// Mark the start of the CPU render and start the GPU timer
+void benchmark_begin_render(benchmark_state &bench)
+{
+	if (bench.frames_rendered >= bench.frame_count)
+		return;
+	bench.render_start = high_resolution_clock::now();
+	glBeginQuery(GL_TIME_ELAPSED, bench.gpu_queries[bench.frames_rendered]);
+}
+
+// Write the recorded timings as JSON
+void write_benchmark_results(const benchmark_state &bench)
+{
+	ofstream file(bench.output);
+	file << "{" << endl;
+	file << "  \"frames\": " << bench.frame_count << "," << endl;
+	file << "  \"delta_time\": " << bench.fixed_delta_time << "," << endl;
+	file << "  \"seed\": " << bench.seed << "," << endl;
+	file << "  \"renderer\": \"" << glGetString(GL_RENDERER) << "\"," << endl;
+	file << "  \"shading\": \"" << (bench.deferred ? "deferred" : "forward") << "\"," << endl;
+	file << "  \"depth_prepass\": " << (bench.prepass ? "true" : "false") << "," << endl;
+	file << "  \"timings\": [" << endl;
+	for (unsigned int i = 0; i < bench.frame_count; ++i)
+	{
+		// GPU time is reported in nanoseconds - blocks until ready
+		GLuint64 gpu_ns = 0;
+		glGetQueryObjectui64v(bench.gpu_queries[i], GL_QUERY_RESULT, &gpu_ns);
+		file << "    { \"frame\": " << i
+			<< ", \"cpu_update_ms\": " << bench.cpu_update_ms[i]
+			<< ", \"cpu_render_ms\": " << bench.cpu_render_ms[i]
+			<< ", \"gpu_ms\": " << gpu_ns / 1.0e6
+			<< " }" << (i + 1 < bench.frame_count ? "," : "") << endl;
+	}
+	file << "  ]" << endl;
+	file << "}" << endl;
+	cout << "Benchmark written to " << bench.output << endl;
+}
+
+// Stop the GPU timer, record the CPU render time and finish the
+// run once all frames have been rendered
+void benchmark_end_render(benchmark_state &bench)
+{
+	if (bench.frames_rendered >= bench.frame_count)
+		return;
+	glEndQuery(GL_TIME_ELAPSED);
+	duration<double, milli> elapsed = high_resolution_clock::now() - bench.render_start;
+	bench.cpu_render_ms[bench.frames_rendered] = elapsed.count();
+	// Move on to the next frame
+	if (++bench.frames_rendered == bench.frame_count)
+	{
+		write_benchmark_results(bench);
+		glDeleteQueries(bench.frame_count, &bench.gpu_queries[0]);
+		// Let the application loop exit
+		glfwSetWindowShouldClose(renderer::get_window(), GL_TRUE);
+	}
+}
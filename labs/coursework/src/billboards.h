@@ -0,0 +1,123 @@
+// billboards.h - Header file containing the billboard renderer
+// Sprites are drawn as instanced quads with no vertex buffers and no
+// geometry shader - each instance is one sprite, its four corners
+// come from gl_VertexID, and billboard.vert pulls the sprite's
+// position (and velocity) straight from the storage buffers that
+// particle.comp writes. A sprite can face the camera, turn about a
+// fixed axis or stretch along its velocity
+// Last modified - 18/10/2026
+
+#pragma once
+
+#include <glm\glm.hpp>
+#include <graphics_framework.h>
+#include "uniform_table.h"
+
+using namespace std;
+using namespace graphics_framework;
+using namespace glm;
+
+// Storage buffer bindings (match particle.comp and billboard.vert)
+#define BILLBOARD_POSITION_BINDING 0
+#define BILLBOARD_VELOCITY_BINDING 1
+
+// Billboard modes (match billboard.vert)
+#define BILLBOARD_FACING 0
+#define BILLBOARD_AXIS 1
+#define BILLBOARD_VELOCITY 2
+
+// Buffers a set of sprites is pulled from
+struct billboard_source
+{
+	// vec4 positions
+	GLuint positions = 0;
+	// vec4 velocities, only read when stretching
+	GLuint velocities = 0;
+	GLuint count = 0;
+};
+
+// How a set of sprites is drawn
+struct billboard_style
+{
+	int mode = BILLBOARD_FACING;
+	// Half the width of a sprite
+	float size = 1.0f;
+	// Axis the sprites turn about (model space)
+	vec3 axis = vec3(0.0f, 1.0f, 0.0f);
+	// Length added behind a sprite per unit of speed
+	float stretch = 0.0f;
+};
+
+// Handles to the uniforms of a billboard effect
+struct billboard_uniforms
+{
+	uniform_handle<mat4> MV;
+	uniform_handle<mat4> P;
+	uniform_handle<int> billboard_mode;
+	uniform_handle<float> billboard_size;
+	uniform_handle<vec3> billboard_axis;
+	uniform_handle<float> billboard_stretch;
+	uniform_handle<vec4> colour;
+	uniform_handle<int> tex;
+};
+
+// Resolve the uniforms of a billboard effect
+billboard_uniforms get_billboard_uniforms(const uniform_table &table)
+{
+	billboard_uniforms u;
+	u.MV = get_handle<mat4>(table, "MV");
+	u.P = get_handle<mat4>(table, "P");
+	u.billboard_mode = get_handle<int>(table, "billboard_mode");
+	u.billboard_size = get_handle<float>(table, "billboard_size");
+	u.billboard_axis = get_handle<vec3>(table, "billboard_axis");
+	u.billboard_stretch = get_handle<float>(table, "billboard_stretch");
+	u.colour = get_handle<vec4>(table, "colour");
+	u.tex = get_handle<int>(table, "tex");
+	return u;
+}
+
+// Upload fixed sprites - positions only, they never stretch
+billboard_source create_billboard_source(const vector<vec4> &positions)
+{
+	billboard_source source;
+	source.count = static_cast<GLuint>(positions.size());
+	glGenBuffers(1, &source.positions);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, source.positions);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(vec4) * positions.size(), &positions[0], GL_STATIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	// Nothing moves, bind the positions in the velocities' place
+	source.velocities = source.positions;
+	return source;
+}
+
+// Load the billboard effects
+void load_billboard_effects(map<string, effect> &effects)
+{
+	// Flat coloured round sprites (comet particles)
+	effects["billboard_colour_eff"].add_shader("shaders/billboard.vert", GL_VERTEX_SHADER);
+	effects["billboard_colour_eff"].add_shader("shaders/billboard_colour.frag", GL_FRAGMENT_SHADER);
+	effects["billboard_colour_eff"].build();
+	// Environment mapped disk (black hole distortion)
+	effects["distortion_eff"].add_shader("shaders/billboard.vert", GL_VERTEX_SHADER);
+	effects["distortion_eff"].add_shader("shaders/billboard_env.frag", GL_FRAGMENT_SHADER);
+	effects["distortion_eff"].build();
+}
+
+// Draw a set of sprites with the billboard effect that is bound. The
+// effect's own uniforms (colour, textures) are left to the caller
+void render_billboards(const billboard_uniforms &u, const billboard_source &source, const billboard_style &style,
+					   const mat4 &MV, const mat4 &P, GLuint vao)
+{
+	set_uniform(u.MV, MV);
+	set_uniform(u.P, P);
+	set_uniform(u.billboard_mode, style.mode);
+	set_uniform(u.billboard_size, style.size);
+	set_uniform(u.billboard_axis, style.axis);
+	set_uniform(u.billboard_stretch, style.stretch);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BILLBOARD_POSITION_BINDING, source.positions);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BILLBOARD_VELOCITY_BINDING, source.velocities);
+	// No attributes, but a vertex array has to be bound to draw
+	glBindVertexArray(vao);
+	glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, source.count);
+	glBindVertexArray(0);
+}
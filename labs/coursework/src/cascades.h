@@ -0,0 +1,171 @@
+// cascades.h - Header file containing the cascaded shadow maps
+// The main spot light's shadow is split along the active camera's
+// view into a few cascades, each a layer of a depth texture array.
+// Every cascade crops the light's projection to the slice of the
+// camera frustum it covers, so the slices near the camera get most
+// of the texels. Split distances can be set or worked out from
+// the camera's near and far planes, and the cascades follow the
+// camera every frame
+// Last modified - 18/10/2026
+
+#pragma once
+
+#include <glm\glm.hpp>
+#include <graphics_framework.h>
+#include "shadow_atlas.h"
+
+using namespace std;
+using namespace graphics_framework;
+using namespace glm;
+
+// Default number of cascades, at most MAX_CASCADES
+#define CASCADE_COUNT 4
+// Size of each cascade layer
+#define CASCADE_SIZE 1024
+// Blend between even (0) and logarithmic (1) default splits
+#define CASCADE_SPLIT_LAMBDA 0.75f
+
+// Cascaded shadow of one spot light
+struct shadow_cascades
+{
+	const spot_light *light = nullptr;
+	GLuint buffer = 0;
+	GLuint depth = 0;
+	int size = CASCADE_SIZE;
+	unsigned int count = CASCADE_COUNT;
+	// Far distance of each cascade from the camera, empty to work
+	// them out from the camera's planes each frame
+	vector<float> splits;
+	// Light projection view cropped to each cascade
+	array<mat4, MAX_CASCADES> light_PV;
+	// World to cascade texture space
+	array<mat4, MAX_CASCADES> shadow_matrices;
+};
+
+// Create the depth texture array for a light's cascades
+void create_shadow_cascades(shadow_cascades &cascades, const spot_light &light,
+							unsigned int count = CASCADE_COUNT, int size = CASCADE_SIZE)
+{
+	cascades.light = &light;
+	cascades.count = glm::clamp(count, 1u, static_cast<unsigned int>(MAX_CASCADES));
+	cascades.size = size;
+	glGenTextures(1, &cascades.depth);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, cascades.depth);
+	glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_DEPTH_COMPONENT24, size, size, cascades.count);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	// Layers are attached as each cascade is rendered
+	glGenFramebuffers(1, &cascades.buffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, cascades.buffer);
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, cascades.depth, 0, 0);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+// Use fixed split distances, one far distance per cascade
+void set_cascade_splits(shadow_cascades &cascades, const vector<float> &splits)
+{
+	cascades.splits = splits;
+	cascades.splits.resize(cascades.count, splits.empty() ? 1000.0f : splits.back());
+}
+
+// Far distance of each cascade between near and far, blending even
+// and logarithmic spacing by lambda
+vector<float> practical_splits(float near_plane, float far_plane, unsigned int count, float lambda = CASCADE_SPLIT_LAMBDA)
+{
+	vector<float> splits(count);
+	for (unsigned int i = 1; i <= count; ++i)
+	{
+		float f = static_cast<float>(i) / count;
+		float log_split = near_plane * pow(far_plane / near_plane, f);
+		float even_split = near_plane + (far_plane - near_plane) * f;
+		splits[i - 1] = mix(even_split, log_split, lambda);
+	}
+	return splits;
+}
+
+// Fit every cascade to its slice of the camera's view frustum
+void update_shadow_cascades(shadow_cascades &cascades, const mat4 &P, const mat4 &V)
+{
+	// Camera planes and field of view from its projection
+	float near_plane = P[3][2] / (P[2][2] - 1.0f);
+	float far_plane = P[3][2] / (P[2][2] + 1.0f);
+	auto splits = cascades.splits.empty() ? practical_splits(near_plane, far_plane, cascades.count) : cascades.splits;
+	mat4 inverse_V = inverse(V);
+	// Full light projection, cropped for each cascade
+	mat4 light_P = perspective<float>(90.f, 1.0f, SHADOW_NEAR, SHADOW_FAR);
+	mat4 light_PV = light_P * spot_light_view(*cascades.light);
+	// Clip space to texture space
+	mat4 bias = translate(mat4(1.0f), vec3(0.5f)) * scale(mat4(1.0f), vec3(0.5f));
+	float slice_near = near_plane;
+	for (unsigned int c = 0; c < cascades.count; ++c)
+	{
+		float slice_far = std::min(splits[c], far_plane);
+		// Bounds of the slice's corners as the light sees them
+		vec2 min_ndc(1.0f);
+		vec2 max_ndc(-1.0f);
+		for (float z : { slice_near, slice_far })
+		{
+			for (float x : { -1.0f, 1.0f })
+			{
+				for (float y : { -1.0f, 1.0f })
+				{
+					// View space corner, the camera looks down -z
+					vec4 corner(x * z / P[0][0], y * z / P[1][1], -z, 1.0f);
+					vec4 clip = light_PV * (inverse_V * corner);
+					// Corners behind the light could be anywhere
+					if (clip.w <= 0.0f)
+					{
+						min_ndc = vec2(-1.0f);
+						max_ndc = vec2(1.0f);
+						continue;
+					}
+					vec2 ndc = vec2(clip) / clip.w;
+					min_ndc = glm::min(min_ndc, ndc);
+					max_ndc = glm::max(max_ndc, ndc);
+				}
+			}
+		}
+		// Never look outside the light's own frustum
+		min_ndc = glm::clamp(min_ndc, vec2(-1.0f), vec2(1.0f));
+		max_ndc = glm::clamp(max_ndc, vec2(-1.0f), vec2(1.0f));
+		vec2 extent = glm::max(max_ndc - min_ndc, vec2(1e-4f));
+		// Scale and move the slice's bounds to fill the layer
+		vec2 crop_scale = 2.0f / extent;
+		vec2 crop_offset = -(min_ndc + max_ndc) / extent;
+		mat4 crop = translate(mat4(1.0f), vec3(crop_offset, 0.0f)) * scale(mat4(1.0f), vec3(crop_scale, 1.0f));
+		cascades.light_PV[c] = crop * light_PV;
+		cascades.shadow_matrices[c] = bias * cascades.light_PV[c];
+		slice_near = slice_far;
+	}
+}
+
+// Upload the cascades into a set of spot lights' shadow data, or
+// mark the set as having none if the cascaded light is not in it
+void update_cascade_data(GLuint buffer, const shadow_cascades &cascades, const vector<spot_light> &spots)
+{
+	shadow_data_std140 data;
+	data.cascade_spot = -1;
+	for (unsigned int i = 0; i < spots.size() && i < MAX_SPOT_LIGHTS; ++i)
+		if (&spots[i] == cascades.light)
+			data.cascade_spot = static_cast<int>(i);
+	data.cascade_count = static_cast<int>(cascades.count);
+	for (unsigned int c = 0; c < MAX_CASCADES; ++c)
+		data.cascade_matrices[c] = c < cascades.count ? cascades.shadow_matrices[c] : mat4(1.0f);
+	GLintptr offset = offsetof(shadow_data_std140, cascade_matrices);
+	GLsizeiptr size = offsetof(shadow_data_std140, omni_point) - offset;
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, offset, size, reinterpret_cast<const char *>(&data) + offset);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+// Bind the cascades for the lit effects to sample
+void bind_shadow_cascades(const shadow_cascades &cascades)
+{
+	glActiveTexture(GL_TEXTURE0 + CASCADE_MAP_UNIT);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, cascades.depth);
+}
@@ -0,0 +1,184 @@
+// clusters.h - Header file containing the clustered lights
+// The lights of a pass live in storage buffers rather than fixed
+// arrays, so a pass can have hundreds. Each frame a compute pass
+// splits the camera's view into a grid of clusters - tiles across
+// the screen, sliced in log depth - and lists the lights that reach
+// each one. The lit effects only shade with the lights listed in
+// their fragment's cluster (part_cluster.frag)
+// Last modified - 18/10/2026
+
+#pragma once
+
+#include <glm\glm.hpp>
+#include <graphics_framework.h>
+#include <cstring>
+#include <limits>
+#include "uniform_blocks.h"
+
+using namespace std;
+using namespace graphics_framework;
+using namespace glm;
+
+// Storage buffer bindings (match the shaders)
+#define POINT_LIGHT_BINDING 4
+#define SPOT_LIGHT_BINDING 5
+#define CLUSTER_COUNT_BINDING 6
+#define CLUSTER_INDEX_BINDING 7
+
+// Clusters across, up and into the screen
+#define CLUSTER_X 16
+#define CLUSTER_Y 9
+#define CLUSTER_Z 24
+// Lights each cluster can list (match part_cluster.frag)
+#define CLUSTER_MAX_POINTS 64
+#define CLUSTER_MAX_SPOTS 32
+// Lights a light set starts with room for, it grows as needed
+#define LIGHT_SET_CAPACITY 256
+// Light level below which a light is taken to reach no further
+#define LIGHT_CUTOFF (1.0f / 256.0f)
+
+// The lights of one pass and their clusters
+struct light_set
+{
+	// Counts and camera (light_data block)
+	GLuint block = 0;
+	// Lights
+	GLuint points = 0;
+	GLuint spots = 0;
+	size_t capacity = 0;
+	// Lights in each cluster
+	GLuint counts = 0;
+	GLuint indices = 0;
+	int point_count = 0;
+	int spot_count = 0;
+};
+
+// Create the buffers of a light set
+void create_light_set(light_set &set, size_t capacity = LIGHT_SET_CAPACITY)
+{
+	set.block = create_uniform_buffer(sizeof(light_data_std140));
+	set.capacity = capacity;
+	glGenBuffers(1, &set.points);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, set.points);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(point_light_std430) * capacity, nullptr, GL_DYNAMIC_DRAW);
+	glGenBuffers(1, &set.spots);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, set.spots);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(spot_light_std430) * capacity, nullptr, GL_DYNAMIC_DRAW);
+	size_t clusters = CLUSTER_X * CLUSTER_Y * CLUSTER_Z;
+	glGenBuffers(1, &set.counts);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, set.counts);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(uvec2) * clusters, nullptr, GL_DYNAMIC_COPY);
+	glGenBuffers(1, &set.indices);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, set.indices);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint) * clusters * (CLUSTER_MAX_POINTS + CLUSTER_MAX_SPOTS), nullptr, GL_DYNAMIC_COPY);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+// Distance at which a light's attenuated colour falls below the cutoff
+float light_range(const vec4 &colour, float constant, float linear, float quadratic)
+{
+	float brightness = std::max(colour.r, std::max(colour.g, colour.b));
+	float c = constant - brightness / LIGHT_CUTOFF;
+	// Solve quadratic * d^2 + linear * d + c = 0
+	if (quadratic > 0.0f)
+		return (-linear + sqrt(linear * linear - 4.0f * quadratic * c)) / (2.0f * quadratic);
+	if (linear > 0.0f)
+		return std::max(-c / linear, 0.0f);
+	// Lights that never fade reach everywhere
+	return numeric_limits<float>::max();
+}
+
+// Upload the lights of a pass, growing the buffers if they are full
+void update_light_set(light_set &set, const vector<point_light> &points, const vector<spot_light> &spots)
+{
+	set.point_count = static_cast<int>(points.size());
+	set.spot_count = static_cast<int>(spots.size());
+	size_t needed = std::max(points.size(), spots.size());
+	if (needed > set.capacity)
+	{
+		set.capacity = std::max(needed, set.capacity * 2);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, set.points);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(point_light_std430) * set.capacity, nullptr, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, set.spots);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(spot_light_std430) * set.capacity, nullptr, GL_DYNAMIC_DRAW);
+	}
+	// Point lights
+	vector<point_light_std430> point_data(points.size());
+	for (size_t i = 0; i < points.size(); ++i)
+	{
+		auto &d = point_data[i];
+		memset(&d, 0, sizeof(d));
+		d.light_colour = points[i].get_light_colour();
+		d.position = points[i].get_position();
+		d.constant = points[i].get_constant_attenuation();
+		d.linear = points[i].get_linear_attenuation();
+		d.quadratic = points[i].get_quadratic_attenuation();
+		d.range = light_range(d.light_colour, d.constant, d.linear, d.quadratic);
+	}
+	// Spot lights
+	vector<spot_light_std430> spot_data(spots.size());
+	for (size_t i = 0; i < spots.size(); ++i)
+	{
+		auto &d = spot_data[i];
+		memset(&d, 0, sizeof(d));
+		d.light_colour = spots[i].get_light_colour();
+		d.position = spots[i].get_position();
+		d.direction = spots[i].get_direction();
+		d.constant = spots[i].get_constant_attenuation();
+		d.linear = spots[i].get_linear_attenuation();
+		d.quadratic = spots[i].get_quadratic_attenuation();
+		d.power = spots[i].get_power();
+		d.range = light_range(d.light_colour, d.constant, d.linear, d.quadratic);
+	}
+	if (!point_data.empty())
+	{
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, set.points);
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(point_light_std430) * point_data.size(), &point_data[0]);
+	}
+	if (!spot_data.empty())
+	{
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, set.spots);
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(spot_light_std430) * spot_data.size(), &spot_data[0]);
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+// Make a light set and the shadows of its lights the ones the
+// following draws read
+void bind_light_set(const light_set &set, GLuint shadows)
+{
+	glBindBufferBase(GL_UNIFORM_BUFFER, LIGHT_DATA_BINDING, set.block);
+	glBindBufferBase(GL_UNIFORM_BUFFER, SHADOW_DATA_BINDING, shadows);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, POINT_LIGHT_BINDING, set.points);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SPOT_LIGHT_BINDING, set.spots);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_COUNT_BINDING, set.counts);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_INDEX_BINDING, set.indices);
+}
+
+// Bin a light set's lights into the clusters of the camera's view
+void build_clusters(light_set &set, effect cluster_eff, const mat4 &P, const mat4 &V)
+{
+	light_data_std140 data;
+	memset(&data, 0, sizeof(data));
+	data.V = V;
+	data.inverse_P = inverse(P);
+	data.cluster_dims = ivec4(CLUSTER_X, CLUSTER_Y, CLUSTER_Z, 0);
+	// Camera planes from its projection
+	float near_plane = P[3][2] / (P[2][2] - 1.0f);
+	float far_plane = P[3][2] / (P[2][2] + 1.0f);
+	data.cluster_params = vec4(renderer::get_screen_width(), renderer::get_screen_height(), near_plane, far_plane);
+	data.point_count = set.point_count;
+	data.spot_count = set.spot_count;
+	glBindBuffer(GL_UNIFORM_BUFFER, set.block);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(data), &data);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	// One invocation per cluster
+	renderer::bind(cluster_eff);
+	glBindBufferBase(GL_UNIFORM_BUFFER, LIGHT_DATA_BINDING, set.block);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, POINT_LIGHT_BINDING, set.points);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SPOT_LIGHT_BINDING, set.spots);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_COUNT_BINDING, set.counts);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_INDEX_BINDING, set.indices);
+	glDispatchCompute((CLUSTER_X + 3) / 4, (CLUSTER_Y + 3) / 4, (CLUSTER_Z + 3) / 4);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
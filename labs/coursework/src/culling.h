@@ -0,0 +1,275 @@
+// culling.h - Header file containing the frustum culling
+// Every object gets a bounding sphere from its mesh's bounding
+// box. The world spheres are kept structure-of-arrays so the plane
+// test can run on 8 (AVX) or 4 (SSE) spheres at once, and each
+// pass culls them against its own frustum - the camera for the
+// main pass and the spot light for the shadow map. Shadow casters
+// are also dropped when their shadow cannot reach anything the
+// camera sees
+// Last modified - 18/10/2026
+
+#pragma once
+
+#include <glm\glm.hpp>
+#include <graphics_framework.h>
+#include <iostream>
+#include <limits>
+#include "transform_cache.h"
+
+// Widest plane test the compiler provides
+#if defined(__AVX2__) || defined(__AVX__)
+#define CULLING_AVX
+#include <immintrin.h>
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define CULLING_SSE
+#include <xmmintrin.h>
+#endif
+
+using namespace std;
+using namespace graphics_framework;
+using namespace glm;
+
+// Passes that cull against their own frustum
+#define CULL_PASS_CAMERA 0
+#define CULL_PASS_SHADOW 1
+#define CULL_PASSES 2
+
+// Spheres tested together, arrays are padded to a multiple of it
+#define CULL_WIDTH 8
+
+// Objects tested and kept by a pass in the last cull
+struct cull_stats
+{
+	unsigned int tested = 0;
+	unsigned int visible = 0;
+};
+
+// Bounding spheres of every transform slot
+struct bounds_table
+{
+	// Object space centre and radius of each slot, slots without
+	// bounds have an infinite radius and are never culled
+	vector<vec3> centre;
+	vector<float> radius;
+	// World space spheres, structure-of-arrays
+	vector<float> x;
+	vector<float> y;
+	vector<float> z;
+	vector<float> r;
+	// Result of the last cull of each pass, 1 if visible
+	array<vector<unsigned char>, CULL_PASSES> visible;
+	// Does each caster's shadow reach a receiver the camera sees
+	vector<unsigned char> casts;
+	array<cull_stats, CULL_PASSES> stats;
+};
+
+// Make room for a slot, padding the world arrays for the kernel
+void reserve_bounds(bounds_table &table, unsigned int slot)
+{
+	if (table.centre.size() > slot)
+		return;
+	table.centre.resize(slot + 1, vec3(0.0f));
+	table.radius.resize(slot + 1, numeric_limits<float>::infinity());
+	size_t padded = (slot + CULL_WIDTH) / CULL_WIDTH * CULL_WIDTH;
+	table.x.resize(padded, 0.0f);
+	table.y.resize(padded, 0.0f);
+	table.z.resize(padded, 0.0f);
+	table.r.resize(padded, 0.0f);
+	for (auto &v : table.visible)
+		v.resize(slot + 1, 1);
+	table.casts.resize(slot + 1, 1);
+}
+
+// Bound a slot by the sphere around its mesh's bounding box
+void set_bounds(bounds_table &table, unsigned int slot, const mesh &m)
+{
+	reserve_bounds(table, slot);
+	vec3 min_point = m.get_minimal();
+	vec3 max_point = m.get_maximal();
+	table.centre[slot] = (min_point + max_point) * 0.5f;
+	table.radius[slot] = length(max_point - min_point) * 0.5f;
+}
+
+// Move every sphere into world space with the cached world matrices
+void update_bounds(bounds_table &table, const transform_cache &transforms)
+{
+	size_t count = std::min(table.centre.size(), transforms.world.size());
+	for (size_t slot = 0; slot < count; ++slot)
+	{
+		auto &M = transforms.world[slot];
+		vec3 c = vec3(M * vec4(table.centre[slot], 1.0f));
+		table.x[slot] = c.x;
+		table.y[slot] = c.y;
+		table.z[slot] = c.z;
+		// Unbounded slots stay unbounded whatever their scale
+		if (isinf(table.radius[slot]))
+		{
+			table.r[slot] = table.radius[slot];
+			continue;
+		}
+		// Largest axis scale of the world matrix
+		float scale = std::max(length(vec3(M[0])), std::max(length(vec3(M[1])), length(vec3(M[2]))));
+		table.r[slot] = table.radius[slot] * scale;
+	}
+}
+
+// Six normalised planes (xyz normal, w distance) of the frustum of
+// a projection view matrix, normals pointing inwards
+array<vec4, 6> extract_frustum_planes(const mat4 &PV)
+{
+	// Rows of the matrix (glm is column major)
+	vec4 rows[4];
+	for (int i = 0; i < 4; ++i)
+		rows[i] = vec4(PV[0][i], PV[1][i], PV[2][i], PV[3][i]);
+	array<vec4, 6> planes = {
+		rows[3] + rows[0], rows[3] - rows[0],
+		rows[3] + rows[1], rows[3] - rows[1],
+		rows[3] + rows[2], rows[3] - rows[2] };
+	for (auto &p : planes)
+		p /= length(vec3(p));
+	return planes;
+}
+
+// Test every sphere against the planes of a pass, a sphere is
+// visible unless it is wholly behind one of them
+void cull_spheres(bounds_table &table, unsigned int pass, const array<vec4, 6> &planes)
+{
+	auto &visible = table.visible[pass];
+	size_t count = table.centre.size();
+	unsigned int kept = 0;
+	size_t i = 0;
+#if defined(CULLING_AVX)
+	for (; i < count; i += 8)
+	{
+		__m256 x = _mm256_loadu_ps(&table.x[i]);
+		__m256 y = _mm256_loadu_ps(&table.y[i]);
+		__m256 z = _mm256_loadu_ps(&table.z[i]);
+		__m256 r = _mm256_loadu_ps(&table.r[i]);
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (auto &p : planes)
+		{
+			// Signed distance of each centre, plus its radius
+			__m256 d = _mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(p.x)), _mm256_set1_ps(p.w));
+			d = _mm256_add_ps(d, _mm256_mul_ps(y, _mm256_set1_ps(p.y)));
+			d = _mm256_add_ps(d, _mm256_mul_ps(z, _mm256_set1_ps(p.z)));
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(d, r), _mm256_setzero_ps(), _CMP_GE_OQ));
+		}
+		int mask = _mm256_movemask_ps(inside);
+		for (size_t j = 0; j < 8 && i + j < count; ++j)
+		{
+			visible[i + j] = (mask >> j) & 1;
+			kept += visible[i + j];
+		}
+	}
+#elif defined(CULLING_SSE)
+	for (; i < count; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(&table.x[i]);
+		__m128 y = _mm_loadu_ps(&table.y[i]);
+		__m128 z = _mm_loadu_ps(&table.z[i]);
+		__m128 r = _mm_loadu_ps(&table.r[i]);
+		__m128 inside = _mm_cmpeq_ps(x, x);
+		for (auto &p : planes)
+		{
+			// Signed distance of each centre, plus its radius
+			__m128 d = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(p.x)), _mm_set1_ps(p.w));
+			d = _mm_add_ps(d, _mm_mul_ps(y, _mm_set1_ps(p.y)));
+			d = _mm_add_ps(d, _mm_mul_ps(z, _mm_set1_ps(p.z)));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(d, r), _mm_setzero_ps()));
+		}
+		int mask = _mm_movemask_ps(inside);
+		for (size_t j = 0; j < 4 && i + j < count; ++j)
+		{
+			visible[i + j] = (mask >> j) & 1;
+			kept += visible[i + j];
+		}
+	}
+#else
+	for (; i < count; ++i)
+	{
+		bool inside = true;
+		for (auto &p : planes)
+			inside = inside && p.x * table.x[i] + p.y * table.y[i] + p.z * table.z[i] + p.w + table.r[i] >= 0.0f;
+		visible[i] = inside ? 1 : 0;
+		kept += visible[i];
+	}
+#endif
+	table.stats[pass].tested = static_cast<unsigned int>(count);
+	table.stats[pass].visible = kept;
+}
+
+// Cull a pass against the frustum of its projection view matrix
+void cull_pass(bounds_table &table, unsigned int pass, const mat4 &PV)
+{
+	cull_spheres(table, pass, extract_frustum_planes(PV));
+}
+
+// Drop the shadow casters whose shadow cannot fall on a receiver
+// visible to the camera. The shadow of a caster is the cone behind
+// it from a light at light_pos, cut off at range. Run after both
+// passes have been culled
+void cull_shadow_receivers(bounds_table &table, const vec3 &light_pos, float range)
+{
+	auto &casters = table.visible[CULL_PASS_SHADOW];
+	auto &receivers = table.visible[CULL_PASS_CAMERA];
+	size_t count = table.centre.size();
+	unsigned int kept = 0;
+	for (size_t i = 0; i < count; ++i)
+	{
+		table.casts[i] = 0;
+		if (!casters[i])
+			continue;
+		vec3 c(table.x[i], table.y[i], table.z[i]);
+		float d = distance(c, light_pos);
+		// Unbounded casters and those around the light always cast
+		if (isinf(table.r[i]) || d <= table.r[i])
+		{
+			table.casts[i] = 1;
+			++kept;
+			continue;
+		}
+		vec3 axis = (c - light_pos) / d;
+		// Cone widening, and the factor a receiver's radius grows by
+		// when measured square to the axis
+		float spread = table.r[i] / d;
+		float slant = 1.0f / sqrt(1.0f - spread * spread);
+		for (size_t j = 0; j < count && !table.casts[i]; ++j)
+		{
+			// The skybox receives nothing
+			if (!receivers[j] || isinf(table.r[j]))
+				continue;
+			vec3 p(table.x[j], table.y[j], table.z[j]);
+			// Nearest point on the axis behind the caster
+			float t = glm::clamp(dot(p - c, axis), 0.0f, std::max(range - d, 0.0f));
+			float cone_radius = table.r[i] + spread * t;
+			if (distance(p, c + axis * t) <= cone_radius + table.r[j] * slant)
+				table.casts[i] = 1;
+		}
+		kept += table.casts[i];
+	}
+	table.stats[CULL_PASS_SHADOW].visible = kept;
+}
+
+// Does a caster in the light's frustum shadow anything visible
+bool casts_visible_shadow(const bounds_table &table, unsigned int slot)
+{
+	return slot >= table.casts.size() || table.casts[slot] != 0;
+}
+
+// Did a slot survive the last cull of a pass
+bool is_visible(const bounds_table &table, unsigned int pass, unsigned int slot)
+{
+	return slot >= table.visible[pass].size() || table.visible[pass][slot] != 0;
+}
+
+// Print the objects culled and submitted by each pass
+void print_cull_stats(const bounds_table &table)
+{
+	const char *names[CULL_PASSES] = { "camera", "shadow" };
+	for (unsigned int pass = 0; pass < CULL_PASSES; ++pass)
+	{
+		auto &s = table.stats[pass];
+		cout << "Cull " << names[pass] << ": " << s.visible << " submitted, "
+			<< s.tested - s.visible << " culled" << endl;
+	}
+}
@@ -0,0 +1,224 @@
+// deferred.h - Header file containing the deferred shading path
+// Instead of lighting every opaque fragment as it is drawn, the
+// effects that have a G-buffer variant write their surface into a
+// compact G-buffer - unlit colour, octahedral normal, albedo and
+// material id, whether it is fogged, and depth - and one screen pass
+// lights each pixel once, fogging it afterwards as the forward
+// shaders do. The G-buffer is a post-processing frame_buffer with the
+// extra targets attached. Effects without a variant (the sun,
+// Rama's inside, the instanced planets, transparents) are still
+// drawn forward after the lighting pass
+// Last modified - 18/10/2026
+
+#pragma once
+
+#include <glm\glm.hpp>
+#include <graphics_framework.h>
+#include "render_queue.h"
+#include "uniform_table.h"
+
+using namespace std;
+using namespace graphics_framework;
+using namespace glm;
+
+// Storage buffer binding of the material table (match deferred_lighting.frag)
+#define DEFERRED_MATERIAL_BINDING 8
+// Material ids fit in the albedo target's 8 bit alpha
+#define DEFERRED_MAX_MATERIALS 255
+
+// std430 material - 64 bytes
+struct deferred_material_std430
+{
+	vec4 emissive;
+	vec4 diffuse_reflection;
+	vec4 specular_reflection;
+	float shininess;
+	float pad[3];
+};
+
+static_assert(sizeof(deferred_material_std430) == 64, "deferred_material_std430 does not match std430");
+
+// Targets of the G-buffer
+struct gbuffer
+{
+	// Unlit colour and depth
+	frame_buffer frame;
+	// Octahedral normals (RG16 snorm)
+	GLuint normal = 0;
+	// Albedo and material id (RGBA8)
+	GLuint albedo = 0;
+	// Fogged surfaces (R8)
+	GLuint fog = 0;
+	// Material table of the frame
+	GLuint materials = 0;
+};
+
+// Handles to the uniforms of the lighting pass
+struct deferred_uniforms
+{
+	uniform_handle<mat4> MVP;
+	uniform_handle<mat4> inverse_PV;
+	uniform_handle<int> gbuffer_colour;
+	uniform_handle<int> gbuffer_normal;
+	uniform_handle<int> gbuffer_albedo;
+	uniform_handle<int> gbuffer_fog;
+	uniform_handle<int> gbuffer_depth;
+};
+
+// Resolve the uniforms of the lighting pass
+deferred_uniforms get_deferred_uniforms(const uniform_table &table)
+{
+	deferred_uniforms u;
+	u.MVP = get_handle<mat4>(table, "MVP");
+	u.inverse_PV = get_handle<mat4>(table, "inverse_PV");
+	u.gbuffer_colour = get_handle<int>(table, "gbuffer_colour");
+	u.gbuffer_normal = get_handle<int>(table, "gbuffer_normal");
+	u.gbuffer_albedo = get_handle<int>(table, "gbuffer_albedo");
+	u.gbuffer_fog = get_handle<int>(table, "gbuffer_fog");
+	u.gbuffer_depth = get_handle<int>(table, "gbuffer_depth");
+	return u;
+}
+
+// Create a G-buffer the size of the screen
+void create_gbuffer(gbuffer &gb, unsigned int width, unsigned int height)
+{
+	gb.frame = frame_buffer(width, height);
+	glGenTextures(1, &gb.normal);
+	glBindTexture(GL_TEXTURE_2D, gb.normal);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_RG16_SNORM, width, height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glGenTextures(1, &gb.albedo);
+	glBindTexture(GL_TEXTURE_2D, gb.albedo);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, width, height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glGenTextures(1, &gb.fog);
+	glBindTexture(GL_TEXTURE_2D, gb.fog);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_R8, width, height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	// The frame buffer's colour is target 0, add the others
+	glBindFramebuffer(GL_FRAMEBUFFER, gb.frame.get_buffer());
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, gb.normal, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, gb.albedo, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT3, GL_TEXTURE_2D, gb.fog, 0);
+	const GLenum targets[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2, GL_COLOR_ATTACHMENT3 };
+	glDrawBuffers(4, targets);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glGenBuffers(1, &gb.materials);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, gb.materials);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(deferred_material_std430) * DEFERRED_MAX_MATERIALS, nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+// Build the G-buffer variant of a lit effect - its own shaders with
+// part_gbuffer.frag standing in for the light and fog parts, so
+// part_fog.frag is left out of the list
+void load_gbuffer_effect(map<string, effect> &effects, const string &name, const string &vertex_shader,
+						 vector<string> frag_shaders)
+{
+	auto &eff = effects[name + "_gbuffer"];
+	eff.add_shader(vertex_shader, GL_VERTEX_SHADER);
+	frag_shaders.push_back("shaders/part_gbuffer.frag");
+	eff.add_shader(frag_shaders, GL_FRAGMENT_SHADER);
+	eff.build();
+}
+
+// Load the G-buffer variants of the lit effects and the lighting
+// pass. Effects lit by their own lights (Rama's inside), the sun
+// and the instanced planets stay forward
+void load_deferred_effects(map<string, effect> &effects)
+{
+	load_gbuffer_effect(effects, "planet_eff", "shaders/planet_shader.vert",
+		{ "shaders/simple_texture.frag", "shaders/part_normal_map.frag" });
+	load_gbuffer_effect(effects, "weather_eff", "shaders/weather.vert", { "shaders/weather.frag" });
+	load_gbuffer_effect(effects, "ship_eff", "shaders/enterprise.vert",
+		{ "shaders/enterprise.frag", "shaders/part_normal_map.frag" });
+	load_gbuffer_effect(effects, "outside_eff", "shaders/planet_shader.vert",
+		{ "shaders/blend.frag", "shaders/part_normal_map.frag" });
+	load_gbuffer_effect(effects, "terrain_eff", "shaders/terrain.vert",
+		{ "shaders/terrain.frag", "shaders/part_weighted_texture_4.frag" });
+	// Lights every pixel of the G-buffer with the same light parts,
+	// then fogs the pixels that asked for it
+	effects["deferred_lighting_eff"].add_shader("shaders/screen.vert", GL_VERTEX_SHADER);
+	vector<string> deferred_lighting_frag_shaders{ "shaders/deferred_lighting.frag", "shaders/part_point.frag", "shaders/part_spot.frag", "shaders/part_shadow.frag", "shaders/part_cluster.frag", "shaders/part_fog.frag" };
+	effects["deferred_lighting_eff"].add_shader(deferred_lighting_frag_shaders, GL_FRAGMENT_SHADER);
+	effects["deferred_lighting_eff"].build();
+}
+
+// Upload the materials the queue handed ids to this frame
+void update_deferred_materials(const gbuffer &gb, const render_queue &queue)
+{
+	size_t count = std::min(queue.materials.size(), static_cast<size_t>(DEFERRED_MAX_MATERIALS));
+	if (count == 0)
+		return;
+	vector<deferred_material_std430> data(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		auto &m = *queue.materials[i];
+		data[i].emissive = m.get_emissive();
+		data[i].diffuse_reflection = m.get_diffuse();
+		data[i].specular_reflection = m.get_specular();
+		data[i].shininess = m.get_shininess();
+		data[i].pad[0] = data[i].pad[1] = data[i].pad[2] = 0.0f;
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, gb.materials);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(deferred_material_std430) * count, &data[0]);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+// Draw the queue through the G-buffer into the frame buffer that is
+// bound when it is called - the G-buffer variants, the lighting pass
+// and then everything else
+void render_deferred(render_queue &queue, const transform_cache &transforms, gbuffer &gb, effect light_eff,
+					 const deferred_uniforms &u, const geometry &screen_quad, const mat4 &PV)
+{
+	GLint target = 0;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &target);
+	sort_queue(queue);
+	// Surfaces into the G-buffer
+	renderer::set_render_target(gb.frame);
+	renderer::clear();
+	queue.materials.clear();
+	queue.material_ids.clear();
+	draw_queue(queue, transforms, [&queue](const render_item &item) { return is_gbuffer_item(queue, item); });
+	update_deferred_materials(gb, queue);
+	// Light every covered pixel once
+	glBindFramebuffer(GL_FRAMEBUFFER, target);
+	glDisable(GL_DEPTH_TEST);
+	glDepthMask(GL_FALSE);
+	renderer::bind(light_eff);
+	set_uniform(u.MVP, mat4(1.0f));
+	set_uniform(u.inverse_PV, inverse(PV));
+	renderer::bind(gb.frame.get_frame(), 0);
+	set_uniform(u.gbuffer_colour, 0);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, gb.normal);
+	set_uniform(u.gbuffer_normal, 1);
+	glActiveTexture(GL_TEXTURE2);
+	glBindTexture(GL_TEXTURE_2D, gb.albedo);
+	set_uniform(u.gbuffer_albedo, 2);
+	glActiveTexture(GL_TEXTURE3);
+	glBindTexture(GL_TEXTURE_2D, gb.fog);
+	set_uniform(u.gbuffer_fog, 3);
+	renderer::bind(gb.frame.get_depth(), 4);
+	set_uniform(u.gbuffer_depth, 4);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DEFERRED_MATERIAL_BINDING, gb.materials);
+	renderer::render(screen_quad);
+	glDepthMask(GL_TRUE);
+	glEnable(GL_DEPTH_TEST);
+	// The forward draws test against the G-buffer's depth
+	GLint width = gb.frame.get_width();
+	GLint height = gb.frame.get_height();
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, gb.frame.get_buffer());
+	glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, target);
+	// Forward opaques that join the prepass (the instanced planets)
+	// lay their depth over the G-buffer's first
+	if (queue.depth_prepass)
+		draw_depth_prepass(queue, transforms);
+	// Everything drawn forward, the background filling what is left
+	draw_queue(queue, transforms, [&queue](const render_item &item) { return !is_gbuffer_item(queue, item); });
+}
@@ -0,0 +1,76 @@
+// geometry_cache.h - Header file containing the geometry cache
+// Procedural shapes and models are built once for each distinct
+// set of parameters and the GPU buffers shared between every mesh
+// that asks for the same shape. A geometry copy shares its vertex
+// array and buffers, so handing out copies costs no VRAM. Nothing
+// is swapped out while the scene runs, so the cache holds every
+// shape for the whole program and the buffers go with the context
+// Last modified - 18/10/2026
+
+#pragma once
+
+#include <glm\glm.hpp>
+#include <graphics_framework.h>
+#include <sstream>
+
+using namespace std;
+using namespace graphics_framework;
+using namespace glm;
+
+// Geometry keyed by builder type and parameters
+struct geometry_cache
+{
+	map<string, geometry> entries;
+	// Number of requests served without building anything
+	unsigned int hits = 0;
+};
+
+// Key for a builder type and its parameters
+string geometry_key(const string &type, unsigned int stacks, unsigned int slices, const vec3 &dims)
+{
+	stringstream key;
+	key << type << ":" << stacks << ":" << slices << ":" << dims.x << "," << dims.y << "," << dims.z;
+	return key.str();
+}
+
+// Look up a key, building the geometry the first time it is seen
+template <typename Builder> geometry cached_geometry(geometry_cache &cache, const string &key, Builder build)
+{
+	auto found = cache.entries.find(key);
+	if (found != cache.entries.end())
+	{
+		++cache.hits;
+		return found->second;
+	}
+	geometry geom = build();
+	cache.entries[key] = geom;
+	return geom;
+}
+
+// Shared sphere
+geometry cached_sphere(geometry_cache &cache, unsigned int stacks, unsigned int slices, const vec3 &dims = vec3(1.0f))
+{
+	return cached_geometry(cache, geometry_key("sphere", stacks, slices, dims),
+		[&]() { return geometry_builder::create_sphere(stacks, slices, dims); });
+}
+
+// Shared cylinder
+geometry cached_cylinder(geometry_cache &cache, unsigned int stacks, unsigned int slices, const vec3 &dims = vec3(1.0f))
+{
+	return cached_geometry(cache, geometry_key("cylinder", stacks, slices, dims),
+		[&]() { return geometry_builder::create_cylinder(stacks, slices, dims); });
+}
+
+// Shared box
+geometry cached_box(geometry_cache &cache, const vec3 &dims = vec3(1.0f))
+{
+	return cached_geometry(cache, geometry_key("box", 0, 0, dims),
+		[&]() { return geometry_builder::create_box(dims); });
+}
+
+// Shared model loaded from a file
+geometry cached_model(geometry_cache &cache, const string &filename)
+{
+	return cached_geometry(cache, "model:" + filename,
+		[&]() { return geometry(filename); });
+}
@@ -0,0 +1,186 @@
+// hiz.h - Header file containing the hierarchical-z occlusion culling
+// Once a frame is drawn its depth is reduced into a mip pyramid
+// where each texel keeps the farthest depth below it. A compute pass
+// then projects every bounding sphere with that frame's camera and
+// compares its nearest depth with the pyramid at the level where the
+// sphere covers a couple of texels. Spheres behind everything there
+// are flagged occluded, and the next frame's camera pass drops them
+// after frustum culling. The flags are a frame old, so they are
+// ignored when the camera has moved or turned too far since, or when
+// the GPU has not finished with them yet
+// Last modified - 18/10/2026
+
+#pragma once
+
+#include <glm\glm.hpp>
+#include <graphics_framework.h>
+#include <cmath>
+#include "culling.h"
+#include "uniform_table.h"
+
+using namespace std;
+using namespace graphics_framework;
+using namespace glm;
+
+// Storage buffer bindings (match hiz_test.comp)
+#define HIZ_SPHERE_BINDING 9
+#define HIZ_RESULT_BINDING 10
+// Camera movement and turn (cosine) past which the flags are stale
+#define HIZ_MAX_MOVE 2.0f
+#define HIZ_MIN_TURN_COS 0.995f
+// Spheres are grown to cover objects moving between frames
+#define HIZ_RADIUS_MARGIN 1.1f
+
+// Depth pyramid and the flags of its last test
+struct hiz_pyramid
+{
+	GLuint depth = 0;
+	int width = 0;
+	int height = 0;
+	int levels = 0;
+	// Spheres tested and their flags, 1 if visible
+	GLuint spheres = 0;
+	GLuint results = 0;
+	size_t capacity = 0;
+	size_t tested = 0;
+	// Signalled once the last test has finished
+	GLsync fence = nullptr;
+	// Camera the flags were made with
+	vec3 cam_pos;
+	vec3 cam_dir;
+	bool valid = false;
+	// Flags read back from the GPU
+	vector<GLuint> visible;
+	// Objects dropped by the last occlusion cull
+	unsigned int occluded = 0;
+};
+
+// Handles to the uniforms of the build and test effects
+struct hiz_uniforms
+{
+	uniform_handle<int> source_level;
+	uniform_handle<mat4> PV;
+	uniform_handle<int> sphere_count;
+	uniform_handle<int> hiz_levels;
+};
+
+// Resolve the uniforms of the build and test effects
+hiz_uniforms get_hiz_uniforms(const uniform_table &build_table, const uniform_table &test_table)
+{
+	hiz_uniforms u;
+	u.source_level = get_handle<int>(build_table, "source_level");
+	u.PV = get_handle<mat4>(test_table, "PV");
+	u.sphere_count = get_handle<int>(test_table, "sphere_count");
+	u.hiz_levels = get_handle<int>(test_table, "hiz_levels");
+	return u;
+}
+
+// Create a pyramid for depth buffers of the given size
+void create_hiz_pyramid(hiz_pyramid &hiz, int width, int height)
+{
+	hiz.width = width;
+	hiz.height = height;
+	hiz.levels = 1 + static_cast<int>(floor(log2(static_cast<float>(std::max(width, height)))));
+	glGenTextures(1, &hiz.depth);
+	glBindTexture(GL_TEXTURE_2D, hiz.depth);
+	glTexStorage2D(GL_TEXTURE_2D, hiz.levels, GL_R32F, width, height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glGenBuffers(1, &hiz.spheres);
+	glGenBuffers(1, &hiz.results);
+}
+
+// Reduce a frame's depth into the pyramid, then test the world
+// spheres of this frame against it with the frame's camera
+void update_hiz(hiz_pyramid &hiz, const frame_buffer &frame, const bounds_table &bounds, effect build_eff,
+				effect test_eff, const hiz_uniforms &u, const mat4 &PV, const vec3 &cam_pos, const vec3 &cam_dir)
+{
+	// BUILD
+	renderer::bind(build_eff);
+	glActiveTexture(GL_TEXTURE0);
+	int width = hiz.width;
+	int height = hiz.height;
+	for (int level = 0; level < hiz.levels; ++level)
+	{
+		// Level 0 copies the depth, the others reduce the one above
+		set_uniform(u.source_level, level - 1);
+		glBindTexture(GL_TEXTURE_2D, level == 0 ? frame.get_depth().get_id() : hiz.depth);
+		glBindImageTexture(0, hiz.depth, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+		glDispatchCompute((width + 7) / 8, (height + 7) / 8, 1);
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+		width = std::max(1, width / 2);
+		height = std::max(1, height / 2);
+	}
+	// TEST
+	size_t count = bounds.centre.size();
+	vector<vec4> spheres(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		// Unbounded slots are always visible
+		float r = isinf(bounds.r[i]) ? -1.0f : bounds.r[i] * HIZ_RADIUS_MARGIN;
+		spheres[i] = vec4(bounds.x[i], bounds.y[i], bounds.z[i], r);
+	}
+	if (count > hiz.capacity)
+	{
+		hiz.capacity = count;
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, hiz.spheres);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(vec4) * count, nullptr, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, hiz.results);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint) * count, nullptr, GL_DYNAMIC_READ);
+	}
+	if (count == 0)
+		return;
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, hiz.spheres);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(vec4) * count, &spheres[0]);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	renderer::bind(test_eff);
+	set_uniform(u.PV, PV);
+	set_uniform(u.sphere_count, static_cast<int>(count));
+	set_uniform(u.hiz_levels, hiz.levels);
+	glBindTexture(GL_TEXTURE_2D, hiz.depth);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, HIZ_SPHERE_BINDING, hiz.spheres);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, HIZ_RESULT_BINDING, hiz.results);
+	glDispatchCompute(static_cast<GLuint>((count + 63) / 64), 1, 1);
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	// Read back next frame, once the GPU is done
+	if (hiz.fence)
+		glDeleteSync(hiz.fence);
+	hiz.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	hiz.tested = count;
+	hiz.cam_pos = cam_pos;
+	hiz.cam_dir = cam_dir;
+	hiz.valid = true;
+}
+
+// Drop the objects the last test found occluded from the camera
+// pass. Run after the camera pass is frustum culled
+void cull_occluded(hiz_pyramid &hiz, bounds_table &bounds, const vec3 &cam_pos, const vec3 &cam_dir)
+{
+	hiz.occluded = 0;
+	if (!hiz.valid || !hiz.fence)
+		return;
+	// Conservative fallback - everything is visible if the flags are
+	// stale or would stall the frame waiting for the GPU
+	if (distance(cam_pos, hiz.cam_pos) > HIZ_MAX_MOVE || dot(cam_dir, hiz.cam_dir) < HIZ_MIN_TURN_COS)
+		return;
+	if (glClientWaitSync(hiz.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+		return;
+	hiz.visible.resize(hiz.tested);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, hiz.results);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GLuint) * hiz.tested, &hiz.visible[0]);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	// Slots added since the test are kept
+	auto &visible = bounds.visible[CULL_PASS_CAMERA];
+	size_t count = std::min(hiz.tested, visible.size());
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (visible[i] && !hiz.visible[i])
+		{
+			visible[i] = 0;
+			++hiz.occluded;
+		}
+	}
+	bounds.stats[CULL_PASS_CAMERA].visible -= hiz.occluded;
+}
@@ -0,0 +1,225 @@
+// instancing.h - Header file containing the instanced planet renderer
+// Bodies that share one mesh are drawn together with a single
+// instanced draw. Each instance's matrices and material index live
+// in a shader storage buffer, the materials in a second one, and
+// the textures are copied into the layers of one 2D texture array
+// so nothing has to be rebound between instances. Instances are
+// grouped by detail level and each level is one instanced draw
+// Last modified - 18/10/2026
+
+#pragma once
+
+#include <glm\glm.hpp>
+#include <graphics_framework.h>
+#include "transform_cache.h"
+#include "uniform_table.h"
+
+using namespace std;
+using namespace graphics_framework;
+using namespace glm;
+
+// Storage buffer bindings (match planet_instanced.vert/.frag)
+#define PLANET_INSTANCE_BINDING 2
+#define PLANET_MATERIAL_BINDING 3
+
+// std430 planet_instance - 208 bytes
+struct planet_instance_std430
+{
+	mat4 M;
+	mat4 MVP;
+	// Normal matrix in the upper 3x3
+	mat4 N;
+	unsigned int material;
+	unsigned int pad[3];
+};
+
+// std430 planet_material - 64 bytes
+struct planet_material_std430
+{
+	vec4 emissive;
+	vec4 diffuse_reflection;
+	vec4 specular_reflection;
+	float shininess;
+	float pad[3];
+};
+
+static_assert(sizeof(planet_instance_std430) == 208, "planet_instance_std430 does not match std430");
+static_assert(sizeof(planet_material_std430) == 64, "planet_material_std430 does not match std430");
+
+// Bodies drawn with one instanced draw
+struct instanced_batch
+{
+	// Mesh every body shares
+	geometry geom;
+	// Detail levels of the mesh, finest (geom) first
+	vector<geometry> levels;
+	// Body for each material / texture layer
+	vector<string> names;
+	// Instances to draw this frame and their detail levels
+	vector<planet_instance_std430> instances;
+	vector<unsigned char> instance_levels;
+	// Instances grouped by level for upload
+	vector<planet_instance_std430> sorted;
+	// First instance of the current draw
+	uniform_handle<int> instance_offset;
+	GLuint instance_buffer = 0;
+	size_t instance_capacity = 0;
+	GLuint material_buffer = 0;
+	GLuint tex_array = 0;
+};
+
+// Copy a set of textures into the layers of a texture array,
+// scaling each to the size of the largest
+GLuint create_texture_array(const vector<texture> &textures)
+{
+	GLsizei width = 1;
+	GLsizei height = 1;
+	for (auto &t : textures)
+	{
+		width = std::max(width, static_cast<GLsizei>(t.get_width()));
+		height = std::max(height, static_cast<GLsizei>(t.get_height()));
+	}
+	GLsizei levels = 1 + static_cast<GLsizei>(floor(log2(static_cast<float>(std::max(width, height)))));
+	GLuint tex_array;
+	glGenTextures(1, &tex_array);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, tex_array);
+	glTexStorage3D(GL_TEXTURE_2D_ARRAY, levels, GL_RGBA8, width, height, static_cast<GLsizei>(textures.size()));
+	// Blit each texture into its layer
+	GLuint fbos[2];
+	glGenFramebuffers(2, fbos);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, fbos[0]);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbos[1]);
+	for (size_t i = 0; i < textures.size(); ++i)
+	{
+		glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures[i].get_id(), 0);
+		glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, tex_array, 0, static_cast<GLint>(i));
+		glBlitFramebuffer(0, 0, static_cast<GLint>(textures[i].get_width()), static_cast<GLint>(textures[i].get_height()),
+						  0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteFramebuffers(2, fbos);
+	// Filtering to match the source textures
+	glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	return tex_array;
+}
+
+// Build a batch from every named body that shares geom
+void load_instanced_batch(instanced_batch &batch, const geometry &geom, const vector<string> &candidates,
+						  map<string, mesh> &objects, map<string, texture> &textures)
+{
+	batch.geom = geom;
+	batch.levels.assign(1, geom);
+	vector<texture> layers;
+	vector<planet_material_std430> materials;
+	for (auto &name : candidates)
+	{
+		auto found = objects.find(name);
+		// Only bodies built on the shared mesh can join
+		if (found == objects.end() ||
+			found->second.get_geometry().get_array_object() != geom.get_array_object())
+			continue;
+		auto &mat = found->second.get_material();
+		planet_material_std430 m;
+		m.emissive = mat.get_emissive();
+		m.diffuse_reflection = mat.get_diffuse();
+		m.specular_reflection = mat.get_specular();
+		m.shininess = mat.get_shininess();
+		m.pad[0] = m.pad[1] = m.pad[2] = 0.0f;
+		materials.push_back(m);
+		layers.push_back(textures[name + "Tex"]);
+		batch.names.push_back(name);
+	}
+	if (batch.names.empty())
+		return;
+	// Materials never change so are uploaded once
+	glGenBuffers(1, &batch.material_buffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, batch.material_buffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(planet_material_std430) * materials.size(), &materials[0], GL_STATIC_DRAW);
+	glGenBuffers(1, &batch.instance_buffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	batch.tex_array = create_texture_array(layers);
+}
+
+// Material index of a body in the batch, -1 if it is not in it
+int instanced_material(const instanced_batch &batch, const string &name)
+{
+	auto found = find(batch.names.begin(), batch.names.end(), name);
+	return found == batch.names.end() ? -1 : static_cast<int>(found - batch.names.begin());
+}
+
+// Start a new frame
+void clear_instances(instanced_batch &batch)
+{
+	batch.instances.clear();
+	batch.instance_levels.clear();
+}
+
+// Add a body to this frame's draw using its cached transforms
+void add_instance(instanced_batch &batch, unsigned int material, const transform_cache &transforms, unsigned int slot,
+				  unsigned int level = 0)
+{
+	planet_instance_std430 inst;
+	inst.M = transforms.world[slot];
+	inst.MVP = transforms.mvp[slot];
+	inst.N = mat4(transforms.normal[slot]);
+	inst.material = material;
+	inst.pad[0] = inst.pad[1] = inst.pad[2] = 0;
+	batch.instances.push_back(inst);
+	batch.instance_levels.push_back(static_cast<unsigned char>(std::min(level, static_cast<unsigned int>(batch.levels.size() - 1))));
+}
+
+// Upload this frame's instances and draw them, one draw per level
+void draw_instanced_batch(instanced_batch &batch)
+{
+	if (batch.instances.empty())
+		return;
+	// Group the instances by level, keeping their order
+	vector<GLint> first(batch.levels.size() + 1, 0);
+	for (auto l : batch.instance_levels)
+		++first[l + 1];
+	for (size_t l = 1; l < first.size(); ++l)
+		first[l] += first[l - 1];
+	batch.sorted.resize(batch.instances.size());
+	vector<GLint> next(first.begin(), first.end() - 1);
+	for (size_t i = 0; i < batch.instances.size(); ++i)
+		batch.sorted[next[batch.instance_levels[i]]++] = batch.instances[i];
+	GLsizeiptr size = sizeof(planet_instance_std430) * batch.sorted.size();
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, batch.instance_buffer);
+	// Grow the buffer when needed, otherwise just overwrite it
+	if (batch.sorted.size() > batch.instance_capacity)
+	{
+		glBufferData(GL_SHADER_STORAGE_BUFFER, size, &batch.sorted[0], GL_DYNAMIC_DRAW);
+		batch.instance_capacity = batch.sorted.size();
+	}
+	else
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, size, &batch.sorted[0]);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PLANET_INSTANCE_BINDING, batch.instance_buffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PLANET_MATERIAL_BINDING, batch.material_buffer);
+	// Texture array on unit 0
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, batch.tex_array);
+	// One draw for every instance at each level
+	for (size_t l = 0; l < batch.levels.size(); ++l)
+	{
+		auto count = first[l + 1] - first[l];
+		if (count == 0)
+			continue;
+		auto &geom = batch.levels[l];
+		set_uniform(batch.instance_offset, first[l]);
+		glBindVertexArray(geom.get_array_object());
+		if (geom.get_index_buffer())
+		{
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, geom.get_index_buffer());
+			glDrawElementsInstanced(geom.get_type(), geom.get_index_count(), GL_UNSIGNED_INT, nullptr, count);
+		}
+		else
+			glDrawArraysInstanced(geom.get_type(), 0, geom.get_vertex_count(), count);
+	}
+	glBindVertexArray(0);
+}
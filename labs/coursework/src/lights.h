@@ -1,6 +1,6 @@
 // lights.h - Header file containing light functions
 // Function to load the lights
-// Last modified - 24/03/2017
+// Last modified - 18/10/2026
 
 #pragma once
 
@@ -11,6 +11,10 @@ using namespace std;
 using namespace graphics_framework;
 using namespace glm;
 
+// Rings of small lights along the inside of Rama
+#define RAMA_LIGHT_RINGS 8
+#define RAMA_LIGHTS_PER_RING 16
+
 // Load the lights
 void load_lights(vector<point_light> &points, vector<spot_light> &spots, vector<point_light> &points_rama, vector<spot_light> &spots_rama, vec3 rama_pos)
 {
@@ -45,4 +49,20 @@ void load_lights(vector<point_light> &points, vector<spot_light> &spots, vector<
 	spots_rama[1].set_direction(normalize(vec3(1.0f, 0.0f, 0.0f)));
 	spots_rama[1].set_range(70.0f);
 	spots_rama[1].set_power(0.1f);
+
+	// Rings of warm lights around Rama's axis (x), after the lights
+	// above so those keep their shadows
+	for (int ring = 0; ring < RAMA_LIGHT_RINGS; ++ring)
+	{
+		float x = -15.0f + 30.0f * ring / (RAMA_LIGHT_RINGS - 1);
+		for (int i = 0; i < RAMA_LIGHTS_PER_RING; ++i)
+		{
+			float angle = two_pi<float>() * i / RAMA_LIGHTS_PER_RING;
+			point_light light;
+			light.set_position(rama_pos + vec3(x, 6.0f * cos(angle), 6.0f * sin(angle)));
+			light.set_light_colour(vec4(1.0f, 0.8f, 0.5f, 1.0f));
+			light.set_range(5.0f);
+			points_rama.push_back(light);
+		}
+	}
 }
\ No newline at end of file
@@ -0,0 +1,338 @@
+// lod.h - Header file containing the level of detail system
+// Each shape gets a chain of detail levels built up front, finer
+// first. Procedural shapes are rebuilt with fewer stacks and slices
+// and models are simplified by clustering their vertices on a grid.
+// Every pass picks a level for each object from the radius it
+// covers on screen, with some hysteresis so an object sitting on a
+// boundary does not flicker between two levels
+// Last modified - 18/10/2026
+
+#pragma once
+
+#include <glm\glm.hpp>
+#include <graphics_framework.h>
+#include <cstdint>
+#include "geometry_cache.h"
+#include "transform_cache.h"
+
+using namespace std;
+using namespace graphics_framework;
+using namespace glm;
+
+// Passes that choose their own levels
+#define LOD_PASS_CAMERA 0
+#define LOD_PASS_SHADOW 1
+#define LOD_PASSES 2
+
+// Projected radius (pixels) the finest level is used above, each
+// coarser level takes over at LOD_STEP of the level before
+#define LOD_FINEST_PIXELS 160.0f
+#define LOD_STEP 0.4f
+// Fraction past a boundary an object must move to change level
+#define LOD_HYSTERESIS 0.15f
+// Fewest stacks or slices a procedural level may have
+#define LOD_MIN_SEGMENTS 8
+
+// Detail levels of one shape, finest first
+struct lod_chain
+{
+	vector<geometry> levels;
+	// Smallest projected radius each level is used at
+	vector<float> thresholds;
+	// Bounding radius in object space
+	float radius = 1.0f;
+};
+
+// Chains and the level each object uses in each pass
+struct lod_table
+{
+	vector<lod_chain> chains;
+	// Chain of each transform slot, -1 for none
+	vector<int> chain;
+	// Current level of each slot in each pass
+	array<vector<unsigned char>, LOD_PASSES> level;
+};
+
+// Read a vertex buffer back from the GPU, empty if it is missing
+template <typename T> vector<T> read_vertex_buffer(const geometry &geom, GLuint index)
+{
+	vector<T> data;
+	GLuint buffer = 0;
+	// Not every shape has every buffer
+	try
+	{
+		buffer = geom.get_buffer(index);
+	}
+	catch (const out_of_range &)
+	{
+	}
+	if (buffer == 0 || geom.get_vertex_count() == 0)
+		return data;
+	data.resize(geom.get_vertex_count());
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glGetBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(T) * data.size(), &data[0]);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	return data;
+}
+
+// Read the indices back, or make them if the geometry has none
+vector<GLuint> read_index_buffer(const geometry &geom)
+{
+	vector<GLuint> indices;
+	if (geom.get_index_buffer())
+	{
+		indices.resize(geom.get_index_count());
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, geom.get_index_buffer());
+		glGetBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, sizeof(GLuint) * indices.size(), &indices[0]);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	}
+	else
+	{
+		indices.resize(geom.get_vertex_count());
+		for (GLuint i = 0; i < indices.size(); ++i)
+			indices[i] = i;
+	}
+	return indices;
+}
+
+// Bounding radius of a geometry about its origin
+float geometry_radius(const geometry &geom)
+{
+	float radius = 0.0f;
+	for (auto &p : read_vertex_buffer<vec3>(geom, BUFFER_INDEXES::POSITION_BUFFER))
+		radius = std::max(radius, length(p));
+	return radius > 0.0f ? radius : 1.0f;
+}
+
+// Simplify a triangle geometry by merging every vertex that falls in
+// the same cell of a cells^3 grid over its bounds. Normals, tangents
+// and binormals are averaged, then the tangent frame is squared up
+geometry simplify_geometry(const geometry &src, unsigned int cells)
+{
+	auto positions = read_vertex_buffer<vec3>(src, BUFFER_INDEXES::POSITION_BUFFER);
+	if (src.get_type() != GL_TRIANGLES || positions.empty())
+		return src;
+	auto normals = read_vertex_buffer<vec3>(src, BUFFER_INDEXES::NORMAL_BUFFER);
+	auto tex_coords = read_vertex_buffer<vec2>(src, BUFFER_INDEXES::TEXTURE_COORDS_0);
+	// Normal mapped models need their tangent frames kept
+	auto tangents = read_vertex_buffer<vec3>(src, BUFFER_INDEXES::TANGENT_BUFFER);
+	auto binormals = read_vertex_buffer<vec3>(src, BUFFER_INDEXES::BINORMAL_BUFFER);
+	auto indices = read_index_buffer(src);
+	// Grid over the bounds
+	vec3 min_point = positions[0];
+	vec3 max_point = positions[0];
+	for (auto &p : positions)
+	{
+		min_point = glm::min(min_point, p);
+		max_point = glm::max(max_point, p);
+	}
+	vec3 cell_size = glm::max((max_point - min_point) / static_cast<float>(cells), vec3(1e-6f));
+	// Average the vertices in each cell
+	map<uint64_t, GLuint> cell_vertex;
+	vector<GLuint> remap(positions.size());
+	vector<vec3> new_positions;
+	vector<vec3> new_normals;
+	vector<vec2> new_tex_coords;
+	vector<vec3> new_tangents;
+	vector<vec3> new_binormals;
+	vector<float> weights;
+	for (size_t i = 0; i < positions.size(); ++i)
+	{
+		uvec3 c = uvec3(glm::min((positions[i] - min_point) / cell_size, vec3(static_cast<float>(cells - 1))));
+		uint64_t key = (static_cast<uint64_t>(c.x) << 42) | (static_cast<uint64_t>(c.y) << 21) | c.z;
+		auto found = cell_vertex.find(key);
+		if (found == cell_vertex.end())
+		{
+			found = cell_vertex.insert(make_pair(key, static_cast<GLuint>(new_positions.size()))).first;
+			new_positions.push_back(vec3(0.0f));
+			new_normals.push_back(vec3(0.0f));
+			new_tangents.push_back(vec3(0.0f));
+			new_binormals.push_back(vec3(0.0f));
+			// Keep the first texture coordinate, averaging across seams smears them
+			new_tex_coords.push_back(tex_coords.empty() ? vec2(0.0f) : tex_coords[i]);
+			weights.push_back(0.0f);
+		}
+		GLuint v = found->second;
+		remap[i] = v;
+		new_positions[v] += positions[i];
+		if (!normals.empty())
+			new_normals[v] += normals[i];
+		if (!tangents.empty())
+			new_tangents[v] += tangents[i];
+		if (!binormals.empty())
+			new_binormals[v] += binormals[i];
+		weights[v] += 1.0f;
+	}
+	for (size_t v = 0; v < new_positions.size(); ++v)
+	{
+		new_positions[v] /= weights[v];
+		if (length(new_normals[v]) > 0.0f)
+			new_normals[v] = normalize(new_normals[v]);
+		// Square the averaged tangent frame up to the averaged normal
+		vec3 &n = new_normals[v];
+		vec3 &t = new_tangents[v];
+		vec3 &b = new_binormals[v];
+		if (tangents.empty() || length(n) == 0.0f)
+			continue;
+		t -= n * dot(n, t);
+		// Tangents that cancel out get any direction across the normal
+		if (length(t) < 1e-6f)
+			t = cross(n, abs(n.x) < 0.9f ? vec3(1.0f, 0.0f, 0.0f) : vec3(0.0f, 1.0f, 0.0f));
+		t = normalize(t);
+		// The binormal keeps the side it was on, mirrored UVs and all
+		vec3 side = cross(n, t);
+		b = binormals.empty() || dot(side, b) >= 0.0f ? side : -side;
+	}
+	// Keep the triangles that did not collapse
+	vector<GLuint> new_indices;
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		GLuint a = remap[indices[i]];
+		GLuint b = remap[indices[i + 1]];
+		GLuint c = remap[indices[i + 2]];
+		if (a == b || b == c || a == c)
+			continue;
+		new_indices.push_back(a);
+		new_indices.push_back(b);
+		new_indices.push_back(c);
+	}
+	geometry geom;
+	geom.set_type(GL_TRIANGLES);
+	geom.add_buffer(new_positions, BUFFER_INDEXES::POSITION_BUFFER);
+	if (!normals.empty())
+		geom.add_buffer(new_normals, BUFFER_INDEXES::NORMAL_BUFFER);
+	if (!tex_coords.empty())
+		geom.add_buffer(new_tex_coords, BUFFER_INDEXES::TEXTURE_COORDS_0);
+	if (!tangents.empty())
+		geom.add_buffer(new_tangents, BUFFER_INDEXES::TANGENT_BUFFER);
+	if (!tangents.empty() && !binormals.empty())
+		geom.add_buffer(new_binormals, BUFFER_INDEXES::BINORMAL_BUFFER);
+	geom.add_index_buffer(new_indices);
+	return geom;
+}
+
+// Switching thresholds for a chain with n levels
+vector<float> lod_thresholds(size_t n)
+{
+	vector<float> thresholds(n, 0.0f);
+	for (size_t i = 0; i + 1 < n; ++i)
+		thresholds[i] = LOD_FINEST_PIXELS * pow(LOD_STEP, static_cast<float>(i));
+	return thresholds;
+}
+
+// Sphere chain, halving the stacks and slices each level
+lod_chain lod_sphere(geometry_cache &cache, unsigned int stacks, unsigned int slices, const vec3 &dims = vec3(1.0f))
+{
+	lod_chain chain;
+	do
+	{
+		chain.levels.push_back(cached_sphere(cache, stacks, slices, dims));
+		stacks /= 2;
+		slices /= 2;
+	} while (stacks >= LOD_MIN_SEGMENTS && slices >= LOD_MIN_SEGMENTS);
+	chain.thresholds = lod_thresholds(chain.levels.size());
+	chain.radius = geometry_radius(chain.levels[0]);
+	return chain;
+}
+
+// Cylinder chain, halving the stacks and slices each level
+lod_chain lod_cylinder(geometry_cache &cache, unsigned int stacks, unsigned int slices, const vec3 &dims = vec3(1.0f))
+{
+	lod_chain chain;
+	do
+	{
+		chain.levels.push_back(cached_cylinder(cache, stacks, slices, dims));
+		stacks /= 2;
+		slices /= 2;
+	} while (stacks >= LOD_MIN_SEGMENTS && slices >= LOD_MIN_SEGMENTS);
+	chain.thresholds = lod_thresholds(chain.levels.size());
+	chain.radius = geometry_radius(chain.levels[0]);
+	return chain;
+}
+
+// Model chain, each level clustered on a grid half as fine
+lod_chain lod_model(geometry_cache &cache, const string &filename)
+{
+	lod_chain chain;
+	geometry model = cached_model(cache, filename);
+	chain.levels.push_back(model);
+	for (unsigned int cells = 64; cells >= 16; cells /= 2)
+	{
+		chain.levels.push_back(cached_geometry(cache, "model:" + filename + ":" + to_string(cells),
+			[&]() { return simplify_geometry(model, cells); }));
+	}
+	chain.thresholds = lod_thresholds(chain.levels.size());
+	chain.radius = geometry_radius(model);
+	return chain;
+}
+
+// Add a chain to the table, returns its id
+unsigned int add_lod_chain(lod_table &table, const lod_chain &chain)
+{
+	table.chains.push_back(chain);
+	return static_cast<unsigned int>(table.chains.size() - 1);
+}
+
+// Draw the object in a slot through a chain
+void assign_lod(lod_table &table, unsigned int slot, unsigned int chain)
+{
+	if (table.chain.size() <= slot)
+	{
+		table.chain.resize(slot + 1, -1);
+		for (auto &l : table.level)
+			l.resize(slot + 1, 0);
+	}
+	table.chain[slot] = static_cast<int>(chain);
+}
+
+// Move current towards the level for a projected radius, only
+// crossing a boundary once past it by the hysteresis margin
+unsigned char select_lod(const lod_chain &chain, unsigned char current, float pixels)
+{
+	unsigned int level = std::min(static_cast<unsigned int>(current), static_cast<unsigned int>(chain.levels.size() - 1));
+	// Finer while comfortably above the next threshold up
+	while (level > 0 && pixels > chain.thresholds[level - 1] * (1.0f + LOD_HYSTERESIS))
+		--level;
+	// Coarser while comfortably below this level's threshold
+	while (level + 1 < chain.levels.size() && pixels < chain.thresholds[level] * (1.0f - LOD_HYSTERESIS))
+		++level;
+	return static_cast<unsigned char>(level);
+}
+
+// Pick the level of every object for a pass seen from eye_pos
+// through projection P with a viewport height pixels tall
+void update_lod(lod_table &table, unsigned int pass, const transform_cache &transforms,
+				const vec3 &eye_pos, const mat4 &P, float height)
+{
+	// Pixels covered by one unit at one unit away
+	float pixels_per_unit = P[1][1] * height * 0.5f;
+	auto &levels = table.level[pass];
+	for (size_t slot = 0; slot < table.chain.size(); ++slot)
+	{
+		if (table.chain[slot] < 0)
+			continue;
+		auto &chain = table.chains[table.chain[slot]];
+		auto &M = transforms.world[slot];
+		// Largest axis scale of the world matrix
+		float scale = std::max(length(vec3(M[0])), std::max(length(vec3(M[1])), length(vec3(M[2]))));
+		float dist = std::max(distance(eye_pos, vec3(M[3])), 1e-3f);
+		float pixels = chain.radius * scale / dist * pixels_per_unit;
+		levels[slot] = select_lod(chain, levels[slot], pixels);
+	}
+}
+
+// Geometry a slot uses in a pass, nullptr to use its own mesh
+const geometry *lod_geometry(const lod_table &table, unsigned int pass, unsigned int slot)
+{
+	if (slot >= table.chain.size() || table.chain[slot] < 0)
+		return nullptr;
+	return &table.chains[table.chain[slot]].levels[table.level[pass][slot]];
+}
+
+// Level a slot uses in a pass
+unsigned int lod_level(const lod_table &table, unsigned int pass, unsigned int slot)
+{
+	if (slot >= table.chain.size() || table.chain[slot] < 0)
+		return 0;
+	return table.level[pass][slot];
+}
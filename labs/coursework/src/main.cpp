@@ -1,15 +1,36 @@
 // Solar system model - A simple interactive model of 
 // the solar system with some spacecraft
-// Last modified - 20/04/2017
+// Last modified - 18/10/2026
 
 #include <glm\glm.hpp>
 #include <graphics_framework.h>
 #include "cameras.h"
+#include "geometry_cache.h"
+#include "lod.h"
+#include "culling.h"
+#include "hiz.h"
+#include "software_occlusion.h"
+#include "shadow_atlas.h"
+#include "shadow_cache.h"
+#include "cascades.h"
+#include "omni_shadow.h"
+#include "shadow_filter.h"
+#include "transform_cache.h"
+#include "uniform_blocks.h"
+#include "clusters.h"
+#include "uniform_table.h"
+#include "scene_graph.h"
 #include "render_helpers.h"
+#include "render_queue.h"
+#include "instancing.h"
 #include "solar_objects.h"
 #include "spacecraft.h"
 #include "lights.h"
 #include "post_processing.h"
+#include "deferred.h"
+#include "overdraw.h"
+#include "billboards.h"
+#include "benchmark.h"
 
 using namespace std;
 using namespace std::chrono;
@@ -18,8 +39,24 @@ using namespace glm;
 
 //Effects
 map<string, effect> effects;
+// Active uniforms of each effect, found once after loading
+map<string, uniform_table> uniform_tables;
+// Resolved uniforms used outside the render queue
+post_processing_uniforms post_uniforms;
+billboard_uniforms distortion_handles;
+billboard_uniforms particle_handles;
+billboard_uniforms overdraw_billboard_handles;
+uniform_handle<int> overdraw_billboard_cost;
+particle_uniforms particle_compute_handles;
+uniform_handle<mat4> shadow_MVP;
+omni_shadow_uniforms omni_handles;
+shadow_filter_uniforms filter_handles;
 
 // Meshes
+// Procedural shapes and models shared between meshes
+geometry_cache geometries;
+// Detail levels of each shape and the level each object uses
+lod_table lods;
 map<string, mesh> solar_objects;
 array<mesh, 7> enterprise;
 array<mesh, 2> motions;
@@ -29,13 +66,33 @@ mesh cube;
 mesh cube_terrain;
 mesh stars;
 
+// Scene graph and transform cache (node index == cache slot)
+scene_graph scene;
+transform_cache transforms;
+map<string, unsigned int> solar_slots;
+array<unsigned int, 7> enterprise_slots;
+array<unsigned int, 2> motions_slots;
+unsigned int rama_slot;
+unsigned int terrain_slot;
+unsigned int stars_slot;
+// Bounding spheres and what each pass can see
+bounds_table bounds;
+// Depth pyramid of the last frame for occlusion culling
+hiz_pyramid hiz;
+hiz_uniforms hiz_handles;
+// CPU depth buffer the big occluders are drawn into each frame
+software_occlusion occlusion_buffer;
+vector<occluder> occluders;
+
 // Particles
 const unsigned int MAX_PARTICLES = 5000;
 vec4 positions[MAX_PARTICLES];
 vec4 velocitys[MAX_PARTICLES];
 GLuint G_Position_buffer, G_Velocity_buffer;
-effect eff;
 effect compute_eff;
+// Comet particles drawn as streaks pulled from the particle buffers
+billboard_source particle_source;
+billboard_style particle_style;
 GLuint vao;
 GLuint pvao;
 
@@ -61,7 +118,25 @@ vector<point_light> points(1);
 vector<spot_light> spots(1);
 vector<point_light> points_rama(1);
 vector<spot_light> spots_rama(2);
-shadow_map shadow;
+// Depth tiles of the shadowed spot lights
+shadow_atlas atlas;
+// Cascaded shadow of the main spot light
+shadow_cascades cascades;
+// Blurred moments of the cascades for soft shadows
+shadow_filter cascade_filter;
+// Static shadow casters rendered once and reused
+shadow_cache shadow_layers;
+// Cube map shadow of the sun's point light
+omni_shadow sun_shadow;
+
+// Shared uniform blocks
+GLuint frame_ubo;
+// Lights of the main pass and of the Rama interior pass and the
+// shadows of their lights
+light_set scene_lights;
+light_set rama_lights;
+GLuint scene_shadows_ubo;
+GLuint rama_shadows_ubo;
 
 // System motion
 map<string, float> orbit_factors;
@@ -83,6 +158,17 @@ float blur_factor = 0.9f;
 frame_buffer first_pass;
 array<frame_buffer, 2> temp_frames;
 
+// Deferred shading
+gbuffer scene_gbuffer;
+deferred_uniforms deferred_handles;
+bool deferred_shading = false;
+// Depth-only pass ahead of the opaques
+bool depth_prepass = false;
+
+// Overdraw and shading cost debug view
+overdraw_view overdraw;
+overdraw_uniforms overdraw_handles;
+
 // Solar activity
 float total_time;
 float explode_factor = 0.0f;
@@ -90,151 +176,508 @@ float random = 0.0f;
 float peak_factor = 2.5f;
 vec3 sun_activity;
 
-// Black hole distortion
-geometry distortion;
+// Black hole distortion - one billboard at the centre
+billboard_source distortion;
 float distortion_size = 1.0f;
 
 // Buckets
 vector<string> planet_eff = { "mercury", "venus", "earth", "mars", "comet", "shadow_plane", "black_hole" };
 
-void render_whole_scene(mat4 P, mat4 V, mat4 LightProjectionMat, vec3 cam_pos)
+// Render queue
+render_queue scene_queue;
+// How each object is drawn
+map<string, draw_info> solar_draws;
+draw_info skybox_draw;
+draw_info terrain_draw;
+draw_info enterprise_draw;
+draw_info motions_draw;
+draw_info rama_outside_draw;
+draw_info rama_inside_draw;
+// Can the camera see into Rama this frame
+bool rama_inside_visible = true;
+// Texture sets for each Jupiter weather pair
+array<unsigned int, 14> jupiter_sets;
+// Planets sharing the sphere, drawn in one instanced draw
+instanced_batch planet_batch;
+unsigned int planet_batch_effect;
+unsigned int planet_batch_id;
+
+// Benchmark
+benchmark_state bench;
+
+// Update the scene graph and compute the transform cache
+void update_transforms(const mat4 &PV)
+{
+	// Rebuild the world matrices of nodes that moved
+	update_scene_graph(scene, transforms);
+	// Compute normal and MVP for every slot in one batch
+	update_transform_cache(transforms, PV);
+}
+
+// Draw the big occluders into the CPU depth buffer and drop the
+// objects they hide from the camera pass
+void cull_software_occluded(const mat4 &PV)
+{
+	clear_software_occlusion(occlusion_buffer, PV);
+	for (auto &o : occluders)
+	{
+		// The terrain only hides things while it is shown
+		if (o.slot == terrain_slot && !demo_shadow)
+			continue;
+		if (!is_visible(bounds, CULL_PASS_CAMERA, o.slot))
+			continue;
+		// The sun's surface is pushed about by its vertex shader,
+		// so only trust a smaller sphere
+		float shrink = o.slot == solar_slots["sun"] ? 0.9f : 1.0f;
+		render_occluder(occlusion_buffer, o, transforms.world[o.slot], shrink);
+	}
+	auto &visible = bounds.visible[CULL_PASS_CAMERA];
+	for (size_t i = 0; i < visible.size(); ++i)
+	{
+		// Unbounded slots are never culled
+		if (!visible[i] || isinf(bounds.r[i]))
+			continue;
+		if (!test_occlusion_sphere(occlusion_buffer, vec3(bounds.x[i], bounds.y[i], bounds.z[i]), bounds.r[i]))
+		{
+			visible[i] = 0;
+			++occlusion_buffer.occluded;
+		}
+	}
+	bounds.stats[CULL_PASS_CAMERA].visible -= occlusion_buffer.occluded;
+}
+
+// Register the effects and texture sets of every object with the render queue
+void load_render_queue()
+{
+	// EFFECTS
+	// Handles the effects set themselves
+	auto cubemap_handle = get_handle<int>(uniform_tables["skybox_eff"], "cubemap");
+	auto sun_handles = get_sun_activity_uniforms(uniform_tables["sun_eff"]);
+	auto inside_MV = get_handle<mat4>(uniform_tables["inside_eff"], "MV");
+	auto terrain_MV = get_handle<mat4>(uniform_tables["terrain_eff"], "MV");
+	auto terrain_gbuffer_MV = get_handle<mat4>(uniform_tables["terrain_eff_gbuffer"], "MV");
+
+	// Skybox - drawn after the opaques at the far plane, so it only
+	// shades the pixels they left uncovered
+	auto skybox_id = add_queue_effect(scene_queue, effects["skybox_eff"], uniform_tables["skybox_eff"],
+		[cubemap_handle](effect &eff, const render_queue &queue)
+		{
+			// Pass at the cleared depth, disable depth mask, face culling
+			glDepthFunc(GL_LEQUAL);
+			glDepthMask(GL_FALSE);
+			glDisable(GL_CULL_FACE);
+			// Bind the cube map and set it
+			renderer::bind(cube_map, 0);
+			set_uniform(cubemap_handle, 0);
+		},
+		[]()
+		{
+			// Restore depth test, depth mask, face culling
+			glDepthFunc(GL_LESS);
+			glDepthMask(GL_TRUE);
+			glEnable(GL_CULL_FACE);
+		});
+	// Planets - lights, eye position and shadow map are shared
+	auto planet_id = add_queue_effect(scene_queue, effects["planet_eff"], uniform_tables["planet_eff"], nullptr);
+	// Sun - no face culling as the light is inside it
+	auto sun_id = add_queue_effect(scene_queue, effects["sun_eff"], uniform_tables["sun_eff"],
+		[sun_handles](effect &eff, const render_queue &queue)
+		{
+			glDisable(GL_CULL_FACE);
+			bind_sun_activity(sun_handles, explode_factor, peak_factor, sun_activity);
+		},
+		[]()
+		{
+			glEnable(GL_CULL_FACE);
+		});
+	// Jupiter
+	auto weather_id = add_queue_effect(scene_queue, effects["weather_eff"], uniform_tables["weather_eff"], nullptr);
+	// Instanced planets - the batch binds its own buffers and textures
+	planet_batch_effect = add_queue_effect(scene_queue, effects["planet_instanced_eff"], uniform_tables["planet_instanced_eff"], nullptr);
+	planet_batch.instance_offset = get_handle<int>(uniform_tables["planet_instanced_eff"], "instance_offset");
+	planet_batch_id = add_queue_batch(scene_queue,
+		[](queue_effect &e)
+		{
+			draw_instanced_batch(planet_batch);
+		});
+	// Clouds - only lit by the point lights
+	auto cloud_id = add_queue_effect(scene_queue, effects["cloud_eff"], uniform_tables["cloud_eff"], nullptr);
+	// Enterprise
+	auto ship_id = add_queue_effect(scene_queue, effects["ship_eff"], uniform_tables["ship_eff"], nullptr);
+	// Rama - the outside must be drawn before the inside so the
+	// inside (drawn without culling) only shows through the ends.
+	// Effects are sorted by id, so register the outside first
+	auto outside_id = add_queue_effect(scene_queue, effects["outside_eff"], uniform_tables["outside_eff"], nullptr);
+	auto inside_id = add_queue_effect(scene_queue, effects["inside_eff"], uniform_tables["inside_eff"],
+		[inside_MV](effect &eff, const render_queue &queue)
+		{
+			glDisable(GL_CULL_FACE);
+			// Lit by Rama's own lights
+			bind_light_set(rama_lights, rama_shadows_ubo);
+			// Set MV matrix uniform
+			set_uniform(inside_MV, queue.V * transforms.world[rama_slot]);
+		},
+		[]()
+		{
+			glEnable(GL_CULL_FACE);
+			bind_light_set(scene_lights, scene_shadows_ubo);
+		});
+	// Terrain
+	auto terrain_id = add_queue_effect(scene_queue, effects["terrain_eff"], uniform_tables["terrain_eff"],
+		[terrain_MV](effect &eff, const render_queue &queue)
+		{
+			// Set MV matrix uniform
+			set_uniform(terrain_MV, queue.V * transforms.world[terrain_slot]);
+		});
+	// Rough fragment costs for the overdraw view - one for a texture
+	// fetch, a few for each light loop and shadow lookup
+	scene_queue.effects[skybox_id].cost = 1;
+	scene_queue.effects[planet_id].cost = 12;
+	scene_queue.effects[sun_id].cost = 6;
+	scene_queue.effects[weather_id].cost = 12;
+	scene_queue.effects[planet_batch_effect].cost = 10;
+	scene_queue.effects[cloud_id].cost = 6;
+	scene_queue.effects[ship_id].cost = 12;
+	scene_queue.effects[outside_id].cost = 14;
+	scene_queue.effects[inside_id].cost = 16;
+	scene_queue.effects[terrain_id].cost = 16;
+	// Effects drawn without culling
+	scene_queue.effects[skybox_id].two_sided = true;
+	scene_queue.effects[sun_id].two_sided = true;
+	scene_queue.effects[inside_id].two_sided = true;
+	set_count_effects(scene_queue, effects, uniform_tables);
+	// Effects whose vertex shaders match the depth prepass, the
+	// instanced planets through their own depth-only effect. Rama's
+	// inside is left out as it is drawn unculled over the outside
+	scene_queue.effects[planet_id].prepass = true;
+	scene_queue.effects[weather_id].prepass = true;
+	scene_queue.effects[ship_id].prepass = true;
+	scene_queue.effects[outside_id].prepass = true;
+	scene_queue.effects[terrain_id].prepass = true;
+	scene_queue.effects[planet_batch_effect].prepass = true;
+	set_prepass_effect(scene_queue, effects["depth_prepass_eff"], uniform_tables["depth_prepass_eff"],
+		effects["depth_prepass_instanced_eff"]);
+	// G-buffer variants, drawn instead while shading is deferred
+	add_deferred_variant(scene_queue, planet_id, effects["planet_eff_gbuffer"], uniform_tables["planet_eff_gbuffer"]);
+	add_deferred_variant(scene_queue, weather_id, effects["weather_eff_gbuffer"], uniform_tables["weather_eff_gbuffer"]);
+	add_deferred_variant(scene_queue, ship_id, effects["ship_eff_gbuffer"], uniform_tables["ship_eff_gbuffer"]);
+	add_deferred_variant(scene_queue, outside_id, effects["outside_eff_gbuffer"], uniform_tables["outside_eff_gbuffer"]);
+	add_deferred_variant(scene_queue, terrain_id, effects["terrain_eff_gbuffer"], uniform_tables["terrain_eff_gbuffer"],
+		[terrain_gbuffer_MV](effect &eff, const render_queue &queue)
+		{
+			// Set MV matrix uniform
+			set_uniform(terrain_gbuffer_MV, queue.V * transforms.world[terrain_slot]);
+		});
+
+	// TEXTURE SETS AND DRAWS
+	skybox_draw = { PASS_BACKGROUND, skybox_id, add_texture_set(scene_queue, {}, {}) };
+	for (auto &e : solar_objects)
+	{
+		auto &name = e.first;
+		vector<texture> texs = { textures[name + "Tex"], normal_maps[name] };
+		vector<string> names = { "tex", "normal_map" };
+		if (name == "sun")
+			solar_draws[name] = { PASS_OPAQUE, sun_id, add_texture_set(scene_queue, texs, names) };
+		// Clouds are drawn over Earth
+		else if (name == "clouds")
+			solar_draws[name] = { PASS_TRANSPARENT, cloud_id, add_texture_set(scene_queue, texs, names) };
+		else if (find(planet_eff.begin(), planet_eff.end(), name) != planet_eff.end())
+			solar_draws[name] = { PASS_OPAQUE, planet_id, add_texture_set(scene_queue, texs, names) };
+	}
+	// Jupiter blends a pair of textures that changes with the weather
+	for (unsigned int i = 0; i < jupiter_sets.size(); i++)
+		jupiter_sets[i] = add_texture_set(scene_queue, { jupiter_texs[i], jupiter_texs[(i + 1) % jupiter_texs.size()] }, { "tex[0]", "tex[1]" });
+	solar_draws["jupiter"] = { PASS_OPAQUE, weather_id, jupiter_sets[0] };
+	// Enterprise and its nacelle domes share the saucer's normal map
+	enterprise_draw = { PASS_OPAQUE, ship_id, add_texture_set(scene_queue, { textures["enterprise"], normal_maps["saucer"] }, { "tex", "normal_map" }) };
+	motions_draw = { PASS_OPAQUE, ship_id, add_texture_set(scene_queue, { motions_textures[0], normal_maps["saucer"] }, { "tex", "normal_map" }) };
+	// Rama
+	rama_outside_draw = { PASS_OPAQUE, outside_id, add_texture_set(scene_queue,
+		{ textures["ramaOutTex"], textures["ramaGrassTex"], textures["blend_map"], normal_maps["ramaOut"] },
+		{ "tex[0]", "tex[1]", "blend_map", "normal_map" }) };
+	rama_inside_draw = { PASS_OPAQUE, inside_id, add_texture_set(scene_queue, { textures["ramaInTex"], normal_maps["earth"] }, { "tex", "normal_map" }) };
+	// Terrain
+	terrain_draw = { PASS_OPAQUE, terrain_id, add_texture_set(scene_queue,
+		{ terrain_texs[0], terrain_texs[1], terrain_texs[2], terrain_texs[3] },
+		{ "tex[0]", "tex[1]", "tex[2]", "tex[3]" }) };
+}
+
+// Add a draw to the render queue
+// Objects outside the camera's frustum are left out
+void submit(const draw_info &draw, mesh &m, material &mat, unsigned int slot)
+{
+	if (!is_visible(bounds, CULL_PASS_CAMERA, slot))
+		return;
+	submit(scene_queue, draw.pass, draw.effect_id, draw.texture_set, m, mat, slot, transforms,
+		lod_geometry(lods, LOD_PASS_CAMERA, slot));
+}
+
+// The black hole's disk, half as wide as the distortion
+billboard_style distortion_style()
+{
+	billboard_style disk;
+	disk.size = 0.5f * distortion_size;
+	return disk;
+}
+
+// Count the billboards into the overdraw view. They test depth but
+// do not write it, so sprites behind sprites still count
+void count_sprites(const mat4 &P, const mat4 &V, bool weighted)
+{
+	renderer::bind(effects["overdraw_billboard_eff"]);
+	glDepthMask(GL_FALSE);
+	// A flat colour
+	set_uniform(overdraw_billboard_cost, 1);
+	render_billboards(overdraw_billboard_handles, particle_source, particle_style, V * transforms.world[solar_slots["comet"]], P, pvao);
+	// A cube map fetch and a reflection
+	if (destroy_solar_system)
+	{
+		set_uniform(overdraw_billboard_cost, weighted ? 2 : 1);
+		render_billboards(overdraw_billboard_handles, distortion, distortion_style(), V, P, pvao);
+	}
+	glDepthMask(GL_TRUE);
+}
+
+void render_whole_scene(mat4 P, mat4 V, vec3 cam_pos)
 {
-	// SET CONSTANT PV VALUE TO SAVE COMPUTING FOR EVERY OBJECT
-	const auto PV = P * V;
-
-	// RENDER SKYBOX
-	render_skybox(effects["skybox_eff"], stars, cube_map, PV);
-
-	// RENDER PLANET_EFF OBJECTS
-	// Bind common resources
-	renderer::bind(effects["planet_eff"]);
-	// Bind lights
-	renderer::bind(points, "points");
-	renderer::bind(spots, "spots");
-	// Set eye position
-	glUniform3fv(effects["planet_eff"].get_uniform_location("eye_pos"), 1, value_ptr(cam_pos));
-	// Bind shadow map texture
-	renderer::bind(shadow.buffer->get_depth(), 2);
-	// Set the shadow_map uniform
-	glUniform1i(effects["planet_eff"].get_uniform_location("shadow_map"), 2);
-
-	// Render solar objects
+	// BUILD THE RENDER QUEUE
+	begin_queue(scene_queue, V, cam_pos);
+	// Opaque draws go through the G-buffer when shading is deferred,
+	// the overdraw view always counts the forward draws
+	scene_queue.deferred = deferred_shading && overdraw.mode == OVERDRAW_OFF;
+	scene_queue.depth_prepass = depth_prepass;
+	// Skybox
+	submit(skybox_draw, stars, stars.get_material(), stars_slot);
+	// Jupiter's textures follow the weather
+	solar_draws["jupiter"].texture_set = jupiter_sets[jupiter_weather_index(weather_factor)];
+	// Solar objects - those sharing the sphere join the instanced batch
+	clear_instances(planet_batch);
+	float batch_depth = numeric_limits<float>::max();
 	for (auto &e : solar_objects)
 	{
 		// Skip those: with scale of 0 (sucked into black hole),
-		//		       not to be rendered unless sun has been clicked,
-		//			   not to be rendererd with planet_eff
+		//		       not to be rendered unless sun has been clicked
 		if (e.second.get_transform().scale == vec3(0.0f) ||
-			(e.first == "black_hole" && destroy_solar_system == false) ||
-			(find(planet_eff.begin(), planet_eff.end(), e.first) == planet_eff.end()))
+			(e.first == "black_hole" && destroy_solar_system == false))
 		{
 			continue;
 		}
-		auto &m = e.second;
-		render_solar_objects(effects["planet_eff"],
-			m, 
-			textures[e.first + "Tex"], normal_maps[e.first],
-			shadow,
-			LightProjectionMat, PV);
+		int material = instanced_material(planet_batch, e.first);
+		if (material >= 0)
+		{
+			unsigned int slot = solar_slots[e.first];
+			if (!is_visible(bounds, CULL_PASS_CAMERA, slot))
+				continue;
+			add_instance(planet_batch, material, transforms, slot, lod_level(lods, LOD_PASS_CAMERA, slot));
+			batch_depth = std::min(batch_depth, distance(cam_pos, vec3(transforms.world[slot][3])));
+		}
+		else
+			submit(solar_draws[e.first], e.second, e.second.get_material(), solar_slots[e.first]);
 	}
-	// Render terrain if necessary
+	// Sorted by its nearest instance
+	if (!planet_batch.instances.empty())
+		submit_batch(scene_queue, PASS_OPAQUE, planet_batch_effect, planet_batch_id, batch_depth);
+	// Terrain if necessary
 	if (demo_shadow == true)
-	{
-		render_terrain_cube(effects["terrain_eff"], cube_terrain, terrain_texs, points, spots, shadow, LightProjectionMat, PV, V, cam_pos);
-	}
+		submit(terrain_draw, cube_terrain, cube_terrain.get_material(), terrain_slot);
+	// Enterprise - every part uses the saucer's material
+	for (size_t i = 0; i < enterprise.size(); i++)
+		submit(enterprise_draw, enterprise[i], enterprise[0].get_material(), enterprise_slots[i]);
+	for (size_t i = 0; i < motions.size(); i++)
+		submit(motions_draw, motions[i], motions[0].get_material(), motions_slots[i]);
+	// Rama - inside uses Earth's material
+	submit(rama_outside_draw, rama, rama.get_material(), rama_slot);
+	if (rama_inside_visible)
+		submit(rama_inside_draw, rama, solar_objects["earth"].get_material(), rama_slot);
 
-	// RENDER THE REST OF THE OBJECTS
-	// Sun
-	render_sun(effects["sun_eff"], 
-		solar_objects["sun"], 
-		textures["sunTex"], normal_maps["sun"],
-		points, spots, 
-		shadow, LightProjectionMat, 
-		PV, cam_pos, 
-		explode_factor, peak_factor, sun_activity);
-
-	// Clouds
-	render_clouds(effects["cloud_eff"],
-		solar_objects["clouds"],
-		textures["cloudsTex"], normal_maps["clouds"],
-		points,
-		PV, cam_pos);
+	// Scene lights and the shadow atlas are shared by every lit effect
+	bind_light_set(scene_lights, scene_shadows_ubo);
+	bind_shadow_atlas(atlas);
+	bind_shadow_cascades(cascades);
+	bind_omni_shadow(sun_shadow);
+	bind_shadow_filter(cascade_filter);
 
-	// Jupiter
-	render_jupiter(effects["weather_eff"],
-		solar_objects["jupiter"],
-		jupiter_texs,
-		points, spots,
-		shadow, LightProjectionMat,
-		PV, cam_pos, weather_factor);
+	// Comet particles move whether or not the scene is shown
+	update_particles(compute_eff, MAX_PARTICLES, G_Position_buffer, G_Velocity_buffer);
 
-	// Comet particles
-	glBindVertexArray(pvao);
-	render_particles(compute_eff, eff, MAX_PARTICLES, G_Position_buffer, G_Velocity_buffer, solar_objects["comet"].get_transform().get_transform_matrix(), PV);
-	glBindVertexArray(0);
+	// Show the overdraw heatmap in place of the scene, the billboards
+	// counted after the queue as they are drawn after it
+	if (overdraw.mode != OVERDRAW_OFF)
+	{
+		render_overdraw(overdraw, scene_queue, transforms, effects["overdraw_heatmap_eff"], overdraw_handles, screen_quad,
+			[&P, &V](bool weighted) { count_sprites(P, V, weighted); });
+		return;
+	}
 
-	// Enterprise
-	render_enterprise(effects["ship_eff"],
-		enterprise, motions,
-		textures["enterprise"], normal_maps["saucer"], motions_textures,
-		points, spots,
-		shadow, LightProjectionMat,
-		PV, cam_pos);
+	// Sort and draw, lighting the G-buffer in one pass if deferred
+	if (scene_queue.deferred)
+		render_deferred(scene_queue, transforms, scene_gbuffer, effects["deferred_lighting_eff"], deferred_handles, screen_quad, P * V);
+	else
+		flush_queue(scene_queue, transforms);
 
-	// Rama
-	render_rama(effects["outside_eff"], effects["inside_eff"], effects["terrain_eff"],
-		rama, rama_terrain,
-		textures["ramaInTex"], textures["ramaOutTex"], textures["ramaGrassTex"], textures["blend_map"], normal_maps["ramaOut"], normal_maps["earth"], solar_objects["earth"].get_material(),
-		terrain_texs,
-		points, spots, points_rama, spots_rama,
-		shadow, LightProjectionMat,
-		PV, V, cam_pos);
+	// Comet particles
+	renderer::bind(effects["billboard_colour_eff"]);
+	set_uniform(particle_handles.colour, vec4(0.3f, 0.4f, 0.52f, 0.75f));
+	render_billboards(particle_handles, particle_source, particle_style, V * transforms.world[solar_slots["comet"]], P, pvao);
 
 	// Distortion
 	if (destroy_solar_system)
 	{
 		renderer::bind(effects["distortion_eff"]);
-		glUniformMatrix4fv(effects["distortion_eff"].get_uniform_location("MV"), 1, GL_FALSE, value_ptr(V));
-		glUniformMatrix4fv(effects["distortion_eff"].get_uniform_location("P"), 1, GL_FALSE, value_ptr(P));
-		glUniform1f(effects["distortion_eff"].get_uniform_location("point_size"), distortion_size);
-		glUniform3fv(effects["distortion_eff"].get_uniform_location("eye_pos"), 1, value_ptr(cam_pos));
 		renderer::bind(cube_map, 0);
-		glUniform1i(effects["distortion_eff"].get_uniform_location("tex"), 0);
-		renderer::render(distortion);
+		set_uniform(distortion_handles.tex, 0);
+		render_billboards(distortion_handles, distortion, distortion_style(), V, P, pvao);
 	}
 }
 
 bool load_content() {
 	load_post_processing(temp_frames, first_pass, frames, temp_frame, screen_quad, alpha_map, effects);
-	load_solar_objects(solar_objects, distortion, textures, jupiter_texs, normal_maps, orbit_factors, effects);
-	load_enterprise(enterprise, motions, textures, motions_textures, normal_maps, effects);
-	load_rama(rama, rama_terrain, textures, terrain_texs, normal_maps, effects);
+	load_solar_objects(solar_objects, textures, jupiter_texs, normal_maps, orbit_factors, effects, geometries);
+	load_enterprise(enterprise, motions, textures, motions_textures, normal_maps, effects, geometries);
+	load_rama(rama, rama_terrain, textures, terrain_texs, normal_maps, effects, geometries);
 	load_terrain(cube_terrain, cube, terrain_texs, effects);
 	load_lights(points, spots, points_rama, spots_rama, rama.get_transform().position);
 	load_cameras(tcam, fcam, ccam);
+	load_billboard_effects(effects);
 	glGenVertexArrays(1, &pvao);
+	distortion = create_billboard_source({ vec4(0.0f, 0.0f, 0.0f, 1.0f) });
 
 	// SKYBOX
-	stars = mesh(geometry_builder::create_box());
+	stars = mesh(cached_box(geometries));
 	stars.get_transform().scale = vec3(1000.0f);
 	array<string, 6> filenames = { "textures/stars_ft.jpg", "textures/stars_bk.jpg", "textures/stars_up.jpg", "textures/stars_dn.jpg", "textures/stars_lt.jpg", "textures/stars_rt.jpg" };
 	cube_map = cubemap(filenames);
 
+	// SCENE GRAPH
+	// Earth goes first so the clouds can follow it
+	solar_slots["earth"] = add_node(scene, transforms, solar_objects["earth"].get_transform());
+	for (auto &e : solar_objects)
+	{
+		if (e.first != "earth" && e.first != "clouds")
+			solar_slots[e.first] = add_node(scene, transforms, e.second.get_transform());
+	}
+	// Clouds follow Earth
+	solar_slots["clouds"] = add_node(scene, transforms, solar_objects["clouds"].get_transform(), solar_slots["earth"]);
+	// Enterprise - each part hangs off the one before it
+	for (size_t i = 0; i < enterprise.size(); i++)
+	{
+		int parent = i == 0 ? -1 : static_cast<int>(enterprise_slots[i - 1]);
+		enterprise_slots[i] = add_node(scene, transforms, enterprise[i].get_transform(), parent);
+	}
+	// Nacelle domes follow the saucer through the connection,
+	// which cancels out the saucer's non-uniform scale
+	for (size_t i = 0; i < motions.size(); i++)
+		motions_slots[i] = add_node(scene, transforms, motions[i].get_transform(), enterprise_slots[1]);
+	rama_slot = add_node(scene, transforms, rama.get_transform());
+	terrain_slot = add_node(scene, transforms, cube_terrain.get_transform());
+	stars_slot = add_node(scene, transforms, stars.get_transform());
+
+	// BOUNDS
+	// The skybox is left unbounded so it is never culled
+	for (auto &e : solar_objects)
+		set_bounds(bounds, solar_slots[e.first], e.second);
+	for (size_t i = 0; i < enterprise.size(); i++)
+		set_bounds(bounds, enterprise_slots[i], enterprise[i]);
+	for (size_t i = 0; i < motions.size(); i++)
+		set_bounds(bounds, motions_slots[i], motions[i]);
+	set_bounds(bounds, rama_slot, rama);
+	set_bounds(bounds, terrain_slot, cube_terrain);
+	reserve_bounds(bounds, stars_slot);
+
+	// OCCLUDERS
+	// The biggest bodies, drawn on the CPU as shapes inside their meshes
+	create_software_occlusion(occlusion_buffer);
+	occluders.push_back({ OCCLUDER_SPHERE, solar_slots["sun"], solar_objects["sun"].get_minimal(), solar_objects["sun"].get_maximal() });
+	occluders.push_back({ OCCLUDER_SPHERE, solar_slots["jupiter"], solar_objects["jupiter"].get_minimal(), solar_objects["jupiter"].get_maximal() });
+	// Only Rama's walls, the inside can be seen through its ends
+	occluders.push_back({ OCCLUDER_TUBE, rama_slot, rama.get_minimal(), rama.get_maximal() });
+	// The terrain's surface is open, so a heightfield under it
+	occluders.push_back(create_heightfield_occluder(terrain_slot,
+		read_vertex_buffer<vec3>(cube_terrain.get_geometry(), BUFFER_INDEXES::POSITION_BUFFER), 8, 16));
+
 	// Load in shaders for skybox
 	effects["skybox_eff"].add_shader("shaders/skybox.vert", GL_VERTEX_SHADER);
 	vector<string> skybox_eff_frag_shaders {"shaders/skybox.frag", "shaders/part_fog.frag" };
 	effects["skybox_eff"].add_shader(skybox_eff_frag_shaders, GL_FRAGMENT_SHADER);
 	effects["skybox_eff"].build();
+	// Depth-only shaders for the opaque prepass
+	effects["depth_prepass_eff"].add_shader("shaders/depth_prepass.vert", GL_VERTEX_SHADER);
+	effects["depth_prepass_eff"].add_shader("shaders/depth_prepass.frag", GL_FRAGMENT_SHADER);
+	effects["depth_prepass_eff"].build();
+	// and for the instanced planets, sharing their vertex shader
+	effects["depth_prepass_instanced_eff"].add_shader("shaders/planet_instanced.vert", GL_VERTEX_SHADER);
+	effects["depth_prepass_instanced_eff"].add_shader("shaders/depth_prepass.frag", GL_FRAGMENT_SHADER);
+	effects["depth_prepass_instanced_eff"].build();
 
 	// SHADOWS
-	shadow = shadow_map(renderer::get_screen_width(), renderer::get_screen_height());
+	// The atlas size and depth format do not follow the window
+	create_shadow_atlas(atlas, SHADOW_ATLAS_SIZE, SHADOW_ATLAS_DEPTH_BITS);
+	// The main spot light's shadow is cascaded over the camera's
+	// view, split evenly blended with logarithmically by default.
+	// Variance shadows are soft enough at half the size
+	create_shadow_cascades(cascades, spots[0], CASCADE_COUNT, CASCADE_FILTERED_SIZE);
+	create_shadow_filter(cascade_filter, cascades, SHADOW_FILTER_VSM);
+	effects["shadow_filter_eff"].add_shader("shaders/shadow_filter.comp", GL_COMPUTE_SHADER);
+	effects["shadow_filter_eff"].build();
+	// The other shadowed spot lights, with the ranges set in load_lights
+	add_shadow_light(atlas, spots_rama[0], 70.0f);
+	add_shadow_light(atlas, spots_rama[1], 70.0f);
 	// Load in shadow shaders
 	effects["shadow_eff"].add_shader("shaders/spot.vert", GL_VERTEX_SHADER);
 	effects["shadow_eff"].add_shader("shaders/spot.frag", GL_FRAGMENT_SHADER);
 	effects["shadow_eff"].build();
+	load_shadow_cache(shadow_layers, atlas);
+	// The sun's point light casts in every direction into a cube map,
+	// all six faces rendered at once through the geometry shader
+	create_omni_shadow(sun_shadow, points[0], OMNI_SHADOW_SIZE, OMNI_SHADOW_FAR);
+	effects["omni_shadow_eff"].add_shader("shaders/omni_shadow.vert", GL_VERTEX_SHADER);
+	effects["omni_shadow_eff"].add_shader("shaders/omni_shadow.geom", GL_GEOMETRY_SHADER);
+	effects["omni_shadow_eff"].add_shader("shaders/omni_shadow.frag", GL_FRAGMENT_SHADER);
+	effects["omni_shadow_eff"].build();
+
+	// DEFERRED SHADING
+	// The G-buffer follows the screen like the post-processing frames
+	create_gbuffer(scene_gbuffer, renderer::get_screen_width(), renderer::get_screen_height());
+	load_deferred_effects(effects);
+
+	// OCCLUSION CULLING
+	// The pyramid is built from the post-processing frames' depth
+	create_hiz_pyramid(hiz, renderer::get_screen_width(), renderer::get_screen_height());
+	effects["hiz_build_eff"].add_shader("shaders/hiz_build.comp", GL_COMPUTE_SHADER);
+	effects["hiz_build_eff"].build();
+	effects["hiz_test_eff"].add_shader("shaders/hiz_test.comp", GL_COMPUTE_SHADER);
+	effects["hiz_test_eff"].build();
+
+	// OVERDRAW VIEW
+	create_overdraw_view(overdraw, renderer::get_screen_width(), renderer::get_screen_height());
+	load_overdraw_effects(effects);
 	
+	// UNIFORM BLOCKS
+	frame_ubo = create_uniform_buffer(sizeof(frame_data_std140));
+	create_light_set(scene_lights);
+	create_light_set(rama_lights);
+	scene_shadows_ubo = create_uniform_buffer(sizeof(shadow_data_std140));
+	rama_shadows_ubo = create_uniform_buffer(sizeof(shadow_data_std140));
+	glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_DATA_BINDING, frame_ubo);
+	// Bins each light set's lights into the camera's clusters
+	effects["cluster_eff"].add_shader("shaders/cluster_lights.comp", GL_COMPUTE_SHADER);
+	effects["cluster_eff"].build();
+
+	// BENCHMARK
+	if (bench.active)
+	{
+		load_benchmark(bench);
+		// Make the sun activity repeatable
+		generator.seed(bench.seed);
+		// Compare the renderers over the same run
+		deferred_shading = bench.deferred;
+		depth_prepass = bench.prepass;
+	}
+
 	// PARTICLES
-	default_random_engine rand(duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count());
+	// Seed from the clock unless the benchmark needs a repeatable run
+	unsigned int seed = bench.active ? bench.seed : static_cast<unsigned int>(duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count());
+	default_random_engine rand(seed);
 	uniform_real_distribution<float> dist;
 	// Initilise particles
 	for (unsigned int i = 0; i < MAX_PARTICLES; ++i) {
@@ -242,9 +685,6 @@ bool load_content() {
 		velocitys[i] = vec4(-(100.0f + (20.0f * dist(rand))), 0.0f, 0.0f, 0.0f);
 	}
 	// Load in shaders
-	eff.add_shader("shaders/basic_colour.vert", GL_VERTEX_SHADER);
-	eff.add_shader("shaders/basic_colour.frag", GL_FRAGMENT_SHADER);
-	eff.build();
 	compute_eff.add_shader("shaders/particle.comp", GL_COMPUTE_SHADER);
 	compute_eff.build();
 	// a useless vao, but we need it bound or we get errors.
@@ -264,10 +704,72 @@ bool load_content() {
 	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(velocitys[0]) * MAX_PARTICLES, velocitys, GL_DYNAMIC_DRAW);
 	//Unbind
 	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	// Draw straight from the buffers, stretched along their motion
+	particle_source.positions = G_Position_buffer;
+	particle_source.velocities = G_Velocity_buffer;
+	particle_source.count = MAX_PARTICLES;
+	particle_style.mode = BILLBOARD_VELOCITY;
+	particle_style.size = 0.5f;
+	particle_style.stretch = 0.02f;
+
+	// UNIFORM TABLES
+	// Introspect every built effect once and resolve the handles
+	build_uniform_tables(effects, uniform_tables);
+	uniform_tables["particle_compute_eff"] = build_uniform_table(compute_eff);
+	load_post_processing_uniforms(post_uniforms, uniform_tables);
+	distortion_handles = get_billboard_uniforms(uniform_tables["distortion_eff"]);
+	particle_handles = get_billboard_uniforms(uniform_tables["billboard_colour_eff"]);
+	overdraw_billboard_handles = get_billboard_uniforms(uniform_tables["overdraw_billboard_eff"]);
+	overdraw_billboard_cost = get_handle<int>(uniform_tables["overdraw_billboard_eff"], "cost");
+	particle_compute_handles = get_particle_uniforms(uniform_tables["particle_compute_eff"]);
+	shadow_MVP = get_handle<mat4>(uniform_tables["shadow_eff"], "MVP");
+	omni_handles = get_omni_shadow_uniforms(uniform_tables["omni_shadow_eff"]);
+	filter_handles = get_shadow_filter_uniforms(uniform_tables["shadow_filter_eff"]);
+	deferred_handles = get_deferred_uniforms(uniform_tables["deferred_lighting_eff"]);
+	overdraw_handles = get_overdraw_uniforms(uniform_tables["overdraw_heatmap_eff"]);
+	hiz_handles = get_hiz_uniforms(uniform_tables["hiz_build_eff"], uniform_tables["hiz_test_eff"]);
+
+	// LEVEL OF DETAIL
+	// Chains built through the geometry cache so level 0 is the
+	// geometry the meshes already share
+	auto sphere_lod = add_lod_chain(lods, lod_sphere(geometries, 100, 100));
+	auto comet_lod = add_lod_chain(lods, lod_model(geometries, "models/Asteroid.obj"));
+	for (auto &e : solar_objects)
+		assign_lod(lods, solar_slots[e.first], e.first == "comet" ? comet_lod : sphere_lod);
+	// Saucer and Rama share a cylinder
+	auto saucer_lod = add_lod_chain(lods, lod_cylinder(geometries, 100, 100));
+	assign_lod(lods, enterprise_slots[0], saucer_lod);
+	assign_lod(lods, rama_slot, saucer_lod);
+	auto shaft_lod = add_lod_chain(lods, lod_cylinder(geometries, 20, 20, vec3(1.5f, 8.0f, 1.5f)));
+	assign_lod(lods, enterprise_slots[2], shaft_lod);
+	auto nacelle_lod = add_lod_chain(lods, lod_cylinder(geometries, 20, 20, vec3(1.0f, 10.0, 1.0f)));
+	assign_lod(lods, enterprise_slots[3], nacelle_lod);
+	assign_lod(lods, enterprise_slots[4], nacelle_lod);
+	auto dome_lod = add_lod_chain(lods, lod_sphere(geometries, 20, 20, vec3(0.5f)));
+	for (auto slot : motions_slots)
+		assign_lod(lods, slot, dome_lod);
+
+	// INSTANCING
+	// Every planet_eff body built on the shared sphere
+	load_instanced_batch(planet_batch, solar_objects["earth"].get_geometry(), planet_eff, solar_objects, textures);
+	planet_batch.levels = lods.chains[sphere_lod].levels;
+
+	// RENDER QUEUE
+	// Effects must be built before the queue takes them
+	load_render_queue();
 	return true;
 }
 
 bool update(float delta_time) {
+	// BENCHMARK
+	// Use a fixed time step and follow the scripted camera path
+	if (bench.active)
+	{
+		benchmark_begin_update(bench);
+		delta_time = bench.fixed_delta_time;
+		benchmark_camera_path(bench, chase_camera_active, free_camera_active, tcam, fcam, ccam, target);
+	}
+
 	// Flip frame
 	current_frame = (current_frame + 1) % 2;
 
@@ -309,6 +811,24 @@ bool update(float delta_time) {
 	if (glfwGetKey(renderer::get_window(), 'O'))
 		demo_shadow = false;
 
+	// Renderer controls - the benchmark picks its own
+	if (!bench.active && glfwGetKey(renderer::get_window(), 'G'))
+		deferred_shading = true;
+	if (!bench.active && glfwGetKey(renderer::get_window(), 'H'))
+		deferred_shading = false;
+	if (!bench.active && glfwGetKey(renderer::get_window(), 'Z'))
+		depth_prepass = true;
+	if (!bench.active && glfwGetKey(renderer::get_window(), 'X'))
+		depth_prepass = false;
+
+	// Debug views - F1 scene, F2 overdraw, F3 shading cost
+	if (glfwGetKey(renderer::get_window(), GLFW_KEY_F1))
+		overdraw.mode = OVERDRAW_OFF;
+	if (glfwGetKey(renderer::get_window(), GLFW_KEY_F2))
+		overdraw.mode = OVERDRAW_COUNT;
+	if (glfwGetKey(renderer::get_window(), GLFW_KEY_F3))
+		overdraw.mode = OVERDRAW_COST;
+
 	// Check if solar system is to be destroyed
 	if (destroy_solar_system == true)
 		black_hole(solar_objects["sun"], solar_objects["black_hole"], distortion_size, blur_factor, delta_time);
@@ -336,8 +856,10 @@ bool update(float delta_time) {
 	// ORBITS
 	system_motion(solar_objects, orbit_factors, destroy_solar_system, delta_time);
 
-	// Update target mesh
+	// Update target mesh - position taken from the scene graph as
+	// the clouds only hold a transform relative to Earth
 	target_mesh = solar_objects[target];
+	target_mesh.get_transform().position = vec3(scene.world[solar_slots[target]][3]);
 
 	// COMET PARTICLES
 	// Bind as GL_SHADER_STORAGE_BUFFER
@@ -345,8 +867,8 @@ bool update(float delta_time) {
 	// Send Data to GPU, use GL_DYNAMIC_DRAW
 	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(velocitys[0]) * MAX_PARTICLES, velocitys, GL_DYNAMIC_DRAW);
 	renderer::bind(compute_eff);
-	glUniform1f(compute_eff.get_uniform_location("delta_time"), std::min(delta_time, 10.0f));
-	glUniform3fv(compute_eff.get_uniform_location("max_dims"), 1, value_ptr(vec3(500.0f, 100.0f, 100.0f)));
+	set_uniform(particle_compute_handles.delta_time, std::min(delta_time, 10.0f));
+	set_uniform(particle_compute_handles.max_dims, vec3(500.0f, 100.0f, 100.0f));
 
 	// CAMERA MODES
 	// Update depending on active camera
@@ -385,7 +907,7 @@ bool update(float delta_time) {
 		{
 			float distance = 0.0f;
 			if (test_ray_oobb(origin, direction, m.second.get_minimal(), m.second.get_maximal(),
-				m.second.get_transform().get_transform_matrix(), distance))
+				scene.world[solar_slots[m.first]], distance))
 			{
 				if (m.first == "sun")
 					destroy_solar_system = true;
@@ -394,16 +916,32 @@ bool update(float delta_time) {
 			}
 		}
 	}
-	// SHADOW MAP UPDATE
-	shadow.light_position = spots[0].get_position();
-	shadow.light_dir = spots[0].get_direction();
-	
+	// SCENE GRAPH
+	// Flag everything that moved this frame
+	for (auto &e : solar_objects)
+		mark_dirty(scene, solar_slots[e.first]);
+	if (engage != vec3(0.0f))
+		mark_dirty(scene, enterprise_slots[0]);
+	for (auto &slot : motions_slots)
+		mark_dirty(scene, slot);
+	mark_dirty(scene, rama_slot);
+	mark_dirty(scene, stars_slot);
+
 	// FPS
-	cout << "FPS: " << 1.0f / delta_time << endl;
+	if (bench.active)
+		benchmark_end_update(bench);
+	else
+	{
+		cout << "FPS: " << 1.0f / delta_time << endl;
+		print_cull_stats(bounds);
+	}
 	return true;
 }
 
 bool render() {
+	// Start the frame timers
+	if (bench.active)
+		benchmark_begin_render(bench);
 	// Get view and projection matrices from active camera
 	mat4 V;
 	mat4 P;
@@ -426,11 +964,61 @@ bool render() {
 		V = tcam.get_view();
 		P = tcam.get_projection();
 	}
-	// Render to shadow map
-	mat4 LightProjectionMat;
-	create_shadow_map(effects["shadow_eff"],
-		solar_objects, enterprise, motions, rama,
-		shadow, LightProjectionMat);
+	// Compute every object's transforms once for every pass
+	update_transforms(P * V);
+	// Cull against the camera, the shadow tiles cull their own casters
+	update_bounds(bounds, transforms);
+	cull_pass(bounds, CULL_PASS_CAMERA, P * V);
+	// Then drop what last frame's depth showed to be hidden
+	vec3 cam_dir = -vec3(V[0][2], V[1][2], V[2][2]);
+	cull_occluded(hiz, bounds, cam_pos, cam_dir);
+	// and what the big occluders hide this frame
+	cull_software_occluded(P * V);
+	// Rama's inside is seen from within or through its open ends
+	rama_inside_visible = is_visible(bounds, CULL_PASS_CAMERA, rama_slot) &&
+		rama_interior_visible(rama, transforms.world[rama_slot], cam_pos, extract_frustum_planes(P * V));
+	// Hand out the shadow atlas to the lights in view
+	float screen_height = static_cast<float>(renderer::get_screen_height());
+	update_shadow_atlas(atlas, cam_pos, extract_frustum_planes(P * V), P[1][1] * screen_height * 0.5f);
+	// Fit the main spot light's cascades to the camera
+	update_shadow_cascades(cascades, P, V);
+	// Pick detail levels for the camera and, from the main spot
+	// light, the shadow pass
+	update_lod(lods, LOD_PASS_CAMERA, transforms, cam_pos, P, screen_height);
+	update_lod(lods, LOD_PASS_SHADOW, transforms, spots[0].get_position(), perspective<float>(90.f, 1.0f, 0.1f, SHADOW_FAR), static_cast<float>(cascades.size));
+	// Upload the camera, fog, lights and shadows once for every effect
+	update_frame_data(frame_ubo, cam_pos);
+	update_light_set(scene_lights, points, spots);
+	// List the lights reaching each cluster of the camera's view
+	build_clusters(scene_lights, effects["cluster_eff"], P, V);
+	update_shadow_data(scene_shadows_ubo, atlas, spots);
+	update_cascade_data(scene_shadows_ubo, cascades, spots);
+	update_omni_data(scene_shadows_ubo, sun_shadow, points);
+	update_filter_data(scene_shadows_ubo, cascade_filter);
+	// Rama's lights only matter when its inside is drawn
+	if (rama_inside_visible)
+	{
+		update_light_set(rama_lights, points_rama, spots_rama);
+		build_clusters(rama_lights, effects["cluster_eff"], P, V);
+		update_shadow_data(rama_shadows_ubo, atlas, spots_rama);
+		update_cascade_data(rama_shadows_ubo, cascades, spots_rama);
+		update_omni_data(rama_shadows_ubo, sun_shadow, points_rama);
+		update_filter_data(rama_shadows_ubo, cascade_filter);
+	}
+	// Find the casters that moved and check the static layer is valid
+	update_shadow_cache(shadow_layers, scene.moved, atlas);
+	// Find the cube map faces that need rendering again
+	update_omni_shadow(sun_shadow, bounds, scene.moved);
+	// Render to the shadow atlas, cascades and cube map
+	create_shadow_map(effects["shadow_eff"], shadow_MVP,
+		effects["omni_shadow_eff"], omni_handles,
+		solar_objects, solar_slots,
+		enterprise, enterprise_slots,
+		motions, motions_slots,
+		rama, rama_slot,
+		atlas, cascades, sun_shadow, transforms, lods, bounds, shadow_layers);
+	// Blur the cascades for the filtered lookups
+	filter_shadow_cascades(cascade_filter, cascades, effects["shadow_filter_eff"], filter_handles);
 
 	// For target and free camera, perform motion blur
 	frame_buffer last_pass;
@@ -442,7 +1030,9 @@ bool render() {
 		// Clear frame
 		renderer::clear();
 		// Render the scene
-		render_whole_scene(P, V, LightProjectionMat, cam_pos);
+		render_whole_scene(P, V, cam_pos);
+		// Find what its depth hides for the next frame
+		update_hiz(hiz, temp_frame, bounds, effects["hiz_build_eff"], effects["hiz_test_eff"], hiz_handles, P * V, cam_pos, cam_dir);
 		// Set render target to current frame
 		renderer::set_render_target(frames[current_frame]);
 		// Clear frame
@@ -452,16 +1042,16 @@ bool render() {
 		// MVP is now the identity matrix
 		mat4 MVP(1.0f);
 		// Set MVP matrix uniform
-		glUniformMatrix4fv(effects["motion_blur"].get_uniform_location("MVP"), 1, GL_FALSE, value_ptr(MVP));
+		set_uniform(post_uniforms.motion_blur_MVP, MVP);
 		// Bind tempframe to TU 0.
 		renderer::bind(temp_frame.get_frame(), 0);
 		// Bind frames[(current_frame + 1) % 2] to TU 1.
 		renderer::bind(frames[(current_frame + 1) % 2].get_frame(), 1);
 		// Set tex uniforms
-		glUniform1i(effects["motion_blur"].get_uniform_location("previous_frame"), 0);
-		glUniform1i(effects["motion_blur"].get_uniform_location("tex"), 1);
+		set_uniform(post_uniforms.motion_blur_previous_frame, 0);
+		set_uniform(post_uniforms.motion_blur_tex, 1);
 		// Set blur factor
-		glUniform1f(effects["motion_blur"].get_uniform_location("blend_factor"), blur_factor);
+		set_uniform(post_uniforms.motion_blur_blend_factor, blur_factor);
 		// Render screen quad
 		renderer::render(screen_quad);
 
@@ -475,15 +1065,15 @@ bool render() {
 			// Bind Cockpit effect
 			renderer::bind(effects["cockpit_eff"]);
 			// Set MVP matrix uniform
-			glUniformMatrix4fv(effects["cockpit_eff"].get_uniform_location("MVP"), 1, GL_FALSE, value_ptr(MVP));
+			set_uniform(post_uniforms.cockpit_MVP, MVP);
 			// Bind texture from frame buffer
 			renderer::bind(frames[current_frame].get_frame(), 0);
 			// Set the tex uniform
-			glUniform1i(effects["cockpit_eff"].get_uniform_location("tex"), 0);
+			set_uniform(post_uniforms.cockpit_tex, 0);
 			// Bind alpha map
 			renderer::bind(alpha_map, 1);
 			// Set the alpha map uniform
-			glUniform1i(effects["cockpit_eff"].get_uniform_location("alpha_map"), 1);
+			set_uniform(post_uniforms.cockpit_alpha_map, 1);
 		}
 		// For target, just the motion blur
 		else
@@ -491,11 +1081,11 @@ bool render() {
 			// Bind Tex effect
 			renderer::bind(effects["tex_eff"]);
 			// Set MVP matrix uniform
-			glUniformMatrix4fv(effects["tex_eff"].get_uniform_location("MVP"), 1, GL_FALSE, value_ptr(MVP));
+			set_uniform(post_uniforms.tex_MVP, MVP);
 			// Bind texture from frame buffer
 			renderer::bind(frames[current_frame].get_frame(), 0);
 			// Set the tex uniform
-			glUniform1i(effects["tex_eff"].get_uniform_location("tex"), 0);
+			set_uniform(post_uniforms.tex_tex, 0);
 		}
 	}
 	// For chase camera, perform depth of field blur
@@ -508,7 +1098,9 @@ bool render() {
 		// Clear frame
 		renderer::clear();
 		// Render the scene
-		render_whole_scene(P, V, LightProjectionMat, cam_pos);
+		render_whole_scene(P, V, cam_pos);
+		// Find what its depth hides for the next frame
+		update_hiz(hiz, first_pass, bounds, effects["hiz_build_eff"], effects["hiz_test_eff"], hiz_handles, P * V, cam_pos, cam_dir);
 		// SECOND PASS
 		last_pass = first_pass;
 		// Perform blur twice
@@ -523,13 +1115,13 @@ bool render() {
 			// MVP is now the identity matrix
 			mat4 MVP(1.0f);
 			// Set MVP matrix uniform
-			glUniformMatrix4fv(effects["blur"].get_uniform_location("MVP"), 1, GL_FALSE, value_ptr(MVP));
+			set_uniform(post_uniforms.blur_MVP, MVP);
 			// Bind frames
 			renderer::bind(last_pass.get_frame(), 0);
 			// Set inverse width
-			glUniform1f(effects["blur"].get_uniform_location("inverse_width"), 1.0f / renderer::get_screen_width());
+			set_uniform(post_uniforms.blur_inverse_width, 1.0f / renderer::get_screen_width());
 			// Set inverse height
-			glUniform1f(effects["blur"].get_uniform_location("inverse_height"), 1.0f / renderer::get_screen_height());
+			set_uniform(post_uniforms.blur_inverse_height, 1.0f / renderer::get_screen_height());
 			// Render screen quad
 			renderer::render(screen_quad);
 			// Set last pass to this pass
@@ -543,33 +1135,40 @@ bool render() {
 		renderer::bind(effects["dof"]);
 		// Set MVP matrix uniform, identity
 		mat4 MVP(1.0f);
-		glUniformMatrix4fv(effects["dof"].get_uniform_location("MVP"), 1, GL_FALSE, value_ptr(MVP));
+		set_uniform(post_uniforms.dof_MVP, MVP);
 		// Bind texture from last pass, 0
 		renderer::bind(last_pass.get_frame(), 0);
 		// Set the uniform, 0
-		glUniform1i(effects["dof"].get_uniform_location("tex"), 0);
+		set_uniform(post_uniforms.dof_tex, 0);
 		// Sharp texture is taken from first pass
 		// bind first pass, 1
 		renderer::bind(first_pass.get_frame(), 1);
 		//set sharp tex uniform, 1
-		glUniform1i(effects["dof"].get_uniform_location("sharp"), 1);
+		set_uniform(post_uniforms.dof_sharp, 1);
 		// Depth also taken from first pass
 		// bind first pass **depth** to  TU 2
 		renderer::bind(first_pass.get_depth(), 2);
 		//set depth tex uniform, 2
-		glUniform1i(effects["dof"].get_uniform_location("depth"), 2);
+		set_uniform(post_uniforms.dof_depth, 2);
 		// Set range and focus values
 		// - range distance to chaser (get from camera)
 		// - focus 0.07f
-		glUniform1f(effects["dof"].get_uniform_location("range"), distance(ccam.get_position(), solar_objects["earth"].get_transform().position));
-		glUniform1f(effects["dof"].get_uniform_location("focus"), 0.07f);
+		set_uniform(post_uniforms.dof_range, distance(ccam.get_position(), solar_objects["earth"].get_transform().position));
+		set_uniform(post_uniforms.dof_focus, 0.07f);
 	}
 	// Render the screen quad
 	renderer::render(screen_quad);
+	// Stop the frame timers
+	if (bench.active)
+		benchmark_end_render(bench);
 	return true;
 }
 
-void main() {
+int main(int argc, char *argv[]) {
+	// Check for benchmark mode, which renders to a hidden window
+	parse_benchmark_args(bench, argc, argv);
+	if (bench.active && !init_benchmark_context(bench))
+		return 1;
 	// Create application
 	app application("Graphics Coursework");
 	// Set load content, update and render methods
@@ -578,4 +1177,8 @@ void main() {
 	application.set_render(render);
 	// Run application
 	application.run();
+	// A benchmark closed before its last frame has no results
+	if (bench.active && bench.frames_rendered < bench.frame_count)
+		return 1;
+	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,173 @@
+// omni_shadow.h - Header file containing the point light shadows
+// A point light's shadow is a depth cube map holding the distance
+// to the nearest caster in every direction. All six faces are
+// rendered in one pass - the geometry shader sends each triangle
+// to the faces (cube map layers) its object touches. Each face
+// keeps its contents until a caster in it moves, so a frame only
+// clears and redraws the faces that changed
+// Last modified - 18/10/2026
+
+#pragma once
+
+#include <glm\glm.hpp>
+#include <graphics_framework.h>
+#include "culling.h"
+#include "uniform_blocks.h"
+#include "uniform_table.h"
+
+using namespace std;
+using namespace graphics_framework;
+using namespace glm;
+
+// Size of each face and the furthest distance a shadow is cast
+#define OMNI_SHADOW_SIZE 1024
+#define OMNI_SHADOW_FAR 1000.0f
+// Every face of the cube
+#define OMNI_ALL_FACES 0x3F
+
+// Cube map shadow of one point light
+struct omni_shadow
+{
+	const point_light *light = nullptr;
+	GLuint buffer = 0;
+	GLuint depth = 0;
+	int size = OMNI_SHADOW_SIZE;
+	float far_plane = OMNI_SHADOW_FAR;
+	// Projection view of each face
+	array<mat4, 6> face_PV;
+	// Faces each slot was last drawn into, one bit each
+	vector<unsigned char> masks;
+	// Faces to clear and redraw this frame
+	unsigned char dirty_faces = OMNI_ALL_FACES;
+	// Where the faces were rendered from
+	vec3 position;
+	bool valid = false;
+	// Faces rendered so far
+	unsigned int face_renders = 0;
+};
+
+// Handles to the uniforms of the omni shadow effect
+struct omni_shadow_uniforms
+{
+	uniform_handle<mat4> M;
+	array<uniform_handle<mat4>, 6> face_PV;
+	uniform_handle<int> face_mask;
+	uniform_handle<vec3> light_pos;
+	uniform_handle<float> far_plane;
+};
+
+// Resolve the uniforms of the omni shadow effect
+omni_shadow_uniforms get_omni_shadow_uniforms(const uniform_table &table)
+{
+	omni_shadow_uniforms u;
+	u.M = get_handle<mat4>(table, "M");
+	for (int i = 0; i < 6; ++i)
+		u.face_PV[i] = get_handle<mat4>(table, "face_PV[" + to_string(i) + "]");
+	u.face_mask = get_handle<int>(table, "face_mask");
+	u.light_pos = get_handle<vec3>(table, "light_pos");
+	u.far_plane = get_handle<float>(table, "far_plane");
+	return u;
+}
+
+// Create the depth cube map, attached whole so every face is a layer
+void create_omni_shadow(omni_shadow &omni, const point_light &light, int size = OMNI_SHADOW_SIZE,
+						float far_plane = OMNI_SHADOW_FAR)
+{
+	omni.light = &light;
+	omni.size = size;
+	omni.far_plane = far_plane;
+	glGenTextures(1, &omni.depth);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, omni.depth);
+	glTexStorage2D(GL_TEXTURE_CUBE_MAP, 1, GL_DEPTH_COMPONENT24, size, size);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+	glGenFramebuffers(1, &omni.buffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, omni.buffer);
+	glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, omni.depth, 0);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+// Work out which faces each caster touches and which faces need
+// redrawing. moved comes from the scene graph
+void update_omni_shadow(omni_shadow &omni, const bounds_table &bounds, const vector<char> &moved)
+{
+	vec3 pos = omni.light->get_position();
+	// A light that moved changes every face
+	if (!omni.valid || pos != omni.position)
+	{
+		omni.dirty_faces = OMNI_ALL_FACES;
+		omni.position = pos;
+		omni.valid = true;
+	}
+	// Cube map face directions and ups (+x, -x, +y, -y, +z, -z)
+	const vec3 dirs[6] = { vec3(1, 0, 0), vec3(-1, 0, 0), vec3(0, 1, 0), vec3(0, -1, 0), vec3(0, 0, 1), vec3(0, 0, -1) };
+	const vec3 ups[6] = { vec3(0, -1, 0), vec3(0, -1, 0), vec3(0, 0, 1), vec3(0, 0, -1), vec3(0, -1, 0), vec3(0, -1, 0) };
+	mat4 P = perspective(half_pi<float>(), 1.0f, 0.1f, omni.far_plane);
+	array<array<vec4, 6>, 6> planes;
+	for (int f = 0; f < 6; ++f)
+	{
+		omni.face_PV[f] = P * lookAt(pos, pos + dirs[f], ups[f]);
+		planes[f] = extract_frustum_planes(omni.face_PV[f]);
+	}
+	size_t count = bounds.centre.size();
+	omni.masks.resize(count, 0);
+	for (size_t slot = 0; slot < count; ++slot)
+	{
+		vec3 c(bounds.x[slot], bounds.y[slot], bounds.z[slot]);
+		float r = bounds.r[slot];
+		unsigned char mask = 0;
+		// Unbounded objects and the light's own body cast nothing
+		if (!isinf(r) && distance(c, pos) > r)
+		{
+			for (int f = 0; f < 6; ++f)
+			{
+				bool inside = true;
+				for (auto &p : planes[f])
+					inside = inside && dot(vec3(p), c) + p.w + r >= 0.0f;
+				if (inside)
+					mask |= 1 << f;
+			}
+		}
+		// A caster that moved changes the faces it left and entered
+		if ((slot < moved.size() && moved[slot]) || mask != omni.masks[slot])
+			omni.dirty_faces |= mask | omni.masks[slot];
+		omni.masks[slot] = mask;
+	}
+}
+
+// Clear the faces about to be redrawn to the far distance
+void clear_omni_faces(const omni_shadow &omni)
+{
+	const float far_depth = 1.0f;
+	for (int f = 0; f < 6; ++f)
+		if (omni.dirty_faces & (1 << f))
+			glClearTexSubImage(omni.depth, 0, 0, 0, f, omni.size, omni.size, 1, GL_DEPTH_COMPONENT, GL_FLOAT, &far_depth);
+}
+
+// Bind the cube map for the lit effects to sample
+void bind_omni_shadow(const omni_shadow &omni)
+{
+	glActiveTexture(GL_TEXTURE0 + OMNI_MAP_UNIT);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, omni.depth);
+}
+
+// Upload the point light's shadow into a set of lights' shadow
+// data, or mark the set as having none if the light is not in it
+void update_omni_data(GLuint buffer, const omni_shadow &omni, const vector<point_light> &points)
+{
+	int omni_point = -1;
+	for (unsigned int i = 0; i < points.size() && i < MAX_POINT_LIGHTS; ++i)
+		if (&points[i] == omni.light)
+			omni_point = static_cast<int>(i);
+	vec4 omni_light(omni.light->get_position(), omni.far_plane);
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, offsetof(shadow_data_std140, omni_point), sizeof(int), &omni_point);
+	glBufferSubData(GL_UNIFORM_BUFFER, offsetof(shadow_data_std140, omni_light), sizeof(vec4), value_ptr(omni_light));
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
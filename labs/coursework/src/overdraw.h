@@ -0,0 +1,133 @@
+// overdraw.h - Header file containing the overdraw debug view
+// Every queued draw is switched to a counting effect that adds to
+// a per-pixel counter image for each fragment it shades. The count
+// is then shown as a heatmap instead of the scene. The cost view
+// adds each effect's rough fragment cost instead of 1, so a pixel
+// covered twice by a cheap effect shows cooler than one covered once
+// by an expensive one. Draws outside the queue, such as the
+// billboards, are counted by a callback with their own counting
+// effect
+// Last modified - 18/10/2026
+
+#pragma once
+
+#include <glm\glm.hpp>
+#include <graphics_framework.h>
+#include <functional>
+#include "render_queue.h"
+#include "uniform_table.h"
+
+using namespace std;
+using namespace graphics_framework;
+using namespace glm;
+
+// Views
+#define OVERDRAW_OFF 0
+#define OVERDRAW_COUNT 1
+#define OVERDRAW_COST 2
+
+// Image unit of the counter image (match the overdraw shaders)
+#define OVERDRAW_IMAGE_UNIT 0
+// Fragments per pixel shown fully red
+#define OVERDRAW_MAX_COUNT 8.0f
+// Cost per pixel shown fully red
+#define OVERDRAW_MAX_COST 64.0f
+
+// Counter image and the view being shown
+struct overdraw_view
+{
+	int mode = OVERDRAW_OFF;
+	GLuint counts = 0;
+	unsigned int width = 0;
+	unsigned int height = 0;
+};
+
+// Handles to the uniforms of the heatmap
+struct overdraw_uniforms
+{
+	uniform_handle<mat4> MVP;
+	uniform_handle<float> max_count;
+};
+
+// Resolve the uniforms of the heatmap
+overdraw_uniforms get_overdraw_uniforms(const uniform_table &table)
+{
+	overdraw_uniforms u;
+	u.MVP = get_handle<mat4>(table, "MVP");
+	u.max_count = get_handle<float>(table, "max_count");
+	return u;
+}
+
+// Create the counter image the size of the screen
+void create_overdraw_view(overdraw_view &view, unsigned int width, unsigned int height)
+{
+	view.width = width;
+	view.height = height;
+	glGenTextures(1, &view.counts);
+	glBindTexture(GL_TEXTURE_2D, view.counts);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_R32UI, width, height);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+// Load the counting and heatmap effects and hand the counting ones
+// to the queue
+void load_overdraw_effects(map<string, effect> &effects)
+{
+	effects["overdraw_count_eff"].add_shader("shaders/overdraw_count.vert", GL_VERTEX_SHADER);
+	effects["overdraw_count_eff"].add_shader("shaders/overdraw_count.frag", GL_FRAGMENT_SHADER);
+	effects["overdraw_count_eff"].build();
+	// Instanced batches keep their own vertex shader
+	effects["overdraw_batch_eff"].add_shader("shaders/planet_instanced.vert", GL_VERTEX_SHADER);
+	effects["overdraw_batch_eff"].add_shader("shaders/overdraw_count.frag", GL_FRAGMENT_SHADER);
+	effects["overdraw_batch_eff"].build();
+	// Billboards keep their vertex shader and drop their corners
+	effects["overdraw_billboard_eff"].add_shader("shaders/billboard.vert", GL_VERTEX_SHADER);
+	effects["overdraw_billboard_eff"].add_shader("shaders/overdraw_billboard.frag", GL_FRAGMENT_SHADER);
+	effects["overdraw_billboard_eff"].build();
+	effects["overdraw_heatmap_eff"].add_shader("shaders/screen.vert", GL_VERTEX_SHADER);
+	effects["overdraw_heatmap_eff"].add_shader("shaders/overdraw_heatmap.frag", GL_FRAGMENT_SHADER);
+	effects["overdraw_heatmap_eff"].build();
+}
+
+// Set the queue's counting effects
+void set_count_effects(render_queue &queue, map<string, effect> &effects, map<string, uniform_table> &tables)
+{
+	auto &c = queue.counters;
+	c.mesh_eff = effects["overdraw_count_eff"];
+	c.batch_eff = effects["overdraw_batch_eff"];
+	c.MVP = get_handle<mat4>(tables["overdraw_count_eff"], "MVP");
+	c.far_plane = get_handle<int>(tables["overdraw_count_eff"], "far_plane");
+	c.mesh_cost = get_handle<int>(tables["overdraw_count_eff"], "cost");
+	c.batch_cost = get_handle<int>(tables["overdraw_batch_eff"], "cost");
+}
+
+// Count the queue's fragments, and those of count_extra (told
+// whether costs are weighted), and draw the heatmap into the frame
+// buffer that is bound
+void render_overdraw(overdraw_view &view, render_queue &queue, const transform_cache &transforms,
+					 effect heatmap_eff, const overdraw_uniforms &u, const geometry &screen_quad,
+					 function<void(bool weighted)> count_extra = nullptr)
+{
+	// Start from nothing drawn
+	GLuint zero = 0;
+	glClearTexImage(view.counts, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+	glBindImageTexture(OVERDRAW_IMAGE_UNIT, view.counts, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
+	// Count with every draw, writing depth only
+	queue.counters.weighted = view.mode == OVERDRAW_COST;
+	sort_queue(queue);
+	if (queue.depth_prepass)
+		draw_depth_prepass(queue, transforms);
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	count_queue(queue, transforms);
+	if (count_extra)
+		count_extra(queue.counters.weighted);
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+	// Show the counts over the whole screen
+	glDisable(GL_DEPTH_TEST);
+	renderer::bind(heatmap_eff);
+	set_uniform(u.MVP, mat4(1.0f));
+	set_uniform(u.max_count, view.mode == OVERDRAW_COST ? OVERDRAW_MAX_COST : OVERDRAW_MAX_COUNT);
+	renderer::render(screen_quad);
+	glEnable(GL_DEPTH_TEST);
+}
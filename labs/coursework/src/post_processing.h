@@ -1,11 +1,12 @@
 // post_processing.h - Header file containing functions related
 // to post-processing techniques
-// Last modified - 20/04/2017
+// Last modified - 18/10/2026
 
 #pragma once
 
 #include <glm\glm.hpp>
 #include <graphics_framework.h>
+#include "uniform_table.h"
 
 using namespace std;
 using namespace graphics_framework;
@@ -61,4 +62,55 @@ void load_post_processing(array<frame_buffer, 2> &temp_frames, frame_buffer &fir
 	effects["dof"].add_shader("shaders/screen.vert", GL_VERTEX_SHADER);
 	effects["dof"].add_shader("shaders/depth_of_field.frag", GL_FRAGMENT_SHADER);
 	effects["dof"].build();
-}
\ No newline at end of file
+}
+
+// Handles to the uniforms of the post-processing effects
+struct post_processing_uniforms
+{
+	// Motion blur
+	uniform_handle<mat4> motion_blur_MVP;
+	uniform_handle<int> motion_blur_tex;
+	uniform_handle<int> motion_blur_previous_frame;
+	uniform_handle<float> motion_blur_blend_factor;
+	// Plain screen texture
+	uniform_handle<mat4> tex_MVP;
+	uniform_handle<int> tex_tex;
+	// Cockpit mask
+	uniform_handle<mat4> cockpit_MVP;
+	uniform_handle<int> cockpit_tex;
+	uniform_handle<int> cockpit_alpha_map;
+	// Blur
+	uniform_handle<mat4> blur_MVP;
+	uniform_handle<float> blur_inverse_width;
+	uniform_handle<float> blur_inverse_height;
+	// Depth of field
+	uniform_handle<mat4> dof_MVP;
+	uniform_handle<int> dof_tex;
+	uniform_handle<int> dof_sharp;
+	uniform_handle<int> dof_depth;
+	uniform_handle<float> dof_range;
+	uniform_handle<float> dof_focus;
+};
+
+// Resolve the post-processing uniforms once the effects are built
+void load_post_processing_uniforms(post_processing_uniforms &u, map<string, uniform_table> &tables)
+{
+	u.motion_blur_MVP = get_handle<mat4>(tables["motion_blur"], "MVP");
+	u.motion_blur_tex = get_handle<int>(tables["motion_blur"], "tex");
+	u.motion_blur_previous_frame = get_handle<int>(tables["motion_blur"], "previous_frame");
+	u.motion_blur_blend_factor = get_handle<float>(tables["motion_blur"], "blend_factor");
+	u.tex_MVP = get_handle<mat4>(tables["tex_eff"], "MVP");
+	u.tex_tex = get_handle<int>(tables["tex_eff"], "tex");
+	u.cockpit_MVP = get_handle<mat4>(tables["cockpit_eff"], "MVP");
+	u.cockpit_tex = get_handle<int>(tables["cockpit_eff"], "tex");
+	u.cockpit_alpha_map = get_handle<int>(tables["cockpit_eff"], "alpha_map");
+	u.blur_MVP = get_handle<mat4>(tables["blur"], "MVP");
+	u.blur_inverse_width = get_handle<float>(tables["blur"], "inverse_width");
+	u.blur_inverse_height = get_handle<float>(tables["blur"], "inverse_height");
+	u.dof_MVP = get_handle<mat4>(tables["dof"], "MVP");
+	u.dof_tex = get_handle<int>(tables["dof"], "tex");
+	u.dof_sharp = get_handle<int>(tables["dof"], "sharp");
+	u.dof_depth = get_handle<int>(tables["dof"], "depth");
+	u.dof_range = get_handle<float>(tables["dof"], "range");
+	u.dof_focus = get_handle<float>(tables["dof"], "focus");
+}
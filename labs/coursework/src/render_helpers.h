@@ -1,684 +1,280 @@
 // render_helpers.h - Header file containing render functions
-// Functions to create a shadow map, render the different
-// objects in the scene and render the fire particle effect
-// render_fire not currently working properly
-// Last modified - 20/04/2017
+// Functions to render the shadow maps, set the state shared by
+// the effects in the render queue and move the comet
+// particles. Lights, eye position and fog come from the
+// shared uniform blocks (uniform_blocks.h)
+// Last modified - 18/10/2026
 
 #pragma once
 
 #include <glm\glm.hpp>
 #include <graphics_framework.h>
-
-// Types of fog
-#define FOG_LINEAR 0
-#define FOG_EXP 1
-#define FOG_EXP2 2
+#include <functional>
+#include "transform_cache.h"
+#include "uniform_blocks.h"
+#include "uniform_table.h"
+#include "lod.h"
+#include "culling.h"
+#include "shadow_atlas.h"
+#include "shadow_cache.h"
+#include "cascades.h"
+#include "omni_shadow.h"
 
 using namespace std;
 using namespace graphics_framework;
 using namespace glm;
 
-// Create a shadow map from the pov of the spot light
-void create_shadow_map(effect shadow_eff, 
-					   map<string, mesh> solar_objects, array<mesh, 7> enterprise, array<mesh, 2> motions,  mesh rama, 
-					   shadow_map &shadow, mat4 &LightProjectionMat)
+// Handles to the transform uniforms of an effect
+struct transform_uniforms
 {
-	// Set render target to shadow map
-	renderer::set_render_target(shadow);
-	// Clear depth buffer bit
-	glClear(GL_DEPTH_BUFFER_BIT);
-	// Set face cull mode to front
-	glCullFace(GL_FRONT);
-	LightProjectionMat = perspective<float>(90.f, renderer::get_screen_aspect(), 0.1f, 1000.f);
-	// Bind shader
-	renderer::bind(shadow_eff);
-	// View matrix taken from shadow map
-	auto V = shadow.get_view();
-	// Render Enterprise
-	for (size_t i = 0; i < enterprise.size(); i++) {
-		// SET M to be the usual mesh transform matrix
-		auto M = enterprise[i].get_transform().get_transform_matrix();
-		// Apply the heirarchy chain
-		for (size_t j = i; j > 0; j--) {
-			M = enterprise[j - 1].get_transform().get_transform_matrix() * M;
-		}
-		auto MVP = LightProjectionMat * V * M;
-		// Set MVP matrix uniform
-		glUniformMatrix4fv(shadow_eff.get_uniform_location("MVP"),
-			1,
-			GL_FALSE,
-			value_ptr(MVP));
-		// Render mesh
-		renderer::render(enterprise[i]);
-	}
-	for (int i = 0; i < motions.size(); i++) {
-		auto m = motions[i];
-		// Create MVP matrix
-		auto M = m.get_transform().get_transform_matrix();
-		auto MVP = LightProjectionMat * V * M;
-		// Set MVP matrix uniform
-		glUniformMatrix4fv(shadow_eff.get_uniform_location("MVP"),
-			1,
-			GL_FALSE,
-			value_ptr(MVP));
-		// Render mesh
-		renderer::render(m);
-	}
-	// Render solar_objects
-	for (auto &e : solar_objects) {
-		auto m = e.second;
-		// Create MVP matrix
-		auto M = m.get_transform().get_transform_matrix();
-		auto MVP = LightProjectionMat * V * M;
-		// Set MVP matrix uniform
-		glUniformMatrix4fv(shadow_eff.get_uniform_location("MVP"),
-			1,
-			GL_FALSE,
-			value_ptr(MVP));
-		// Render mesh
-		renderer::render(m);
-	}
-	// Render Rama
-	auto m = rama;
-	auto M = m.get_transform().get_transform_matrix();
-	auto MVP = LightProjectionMat * V * M;
-	// Set MVP matrix uniform
-	glUniformMatrix4fv(shadow_eff.get_uniform_location("MVP"),
-		1,
-		GL_FALSE,
-		value_ptr(MVP));
-	// Render mesh
-	renderer::render(m);
-	// Set render target back to the screen
-	renderer::set_render_target();
-	// Set face cull mode to back
-	glCullFace(GL_BACK);
+	uniform_handle<mat4> MVP;
+	uniform_handle<mat4> M;
+	uniform_handle<mat3> N;
+};
+
+// Resolve the transform uniforms of an effect
+transform_uniforms get_transform_uniforms(const uniform_table &table)
+{
+	transform_uniforms u;
+	u.MVP = get_handle<mat4>(table, "MVP");
+	u.M = get_handle<mat4>(table, "M");
+	u.N = get_handle<mat3>(table, "N");
+	return u;
 }
 
-// Render the clouds around Earth
-void render_clouds(effect cloud_eff, 
-				   mesh clouds, 
-				   texture cloudsTex, texture normal_map, 
-				   vector<point_light> points, 
-				   mat4 PV, vec3 cam_pos)
+// Set the cached M, N and MVP uniforms for a slot
+void bind_transforms(const transform_uniforms &u, const transform_cache &transforms, unsigned int slot)
 {
-	// Render clouds
-	renderer::bind(cloud_eff);
-	// Create MVP matrix
-	auto M = clouds.get_transform().get_transform_matrix();
-	auto MVP = PV * M;
 	// Set MVP matrix uniform
-	glUniformMatrix4fv(cloud_eff.get_uniform_location("MVP"),
-		1,
-		GL_FALSE,
-		value_ptr(MVP));
+	set_uniform(u.MVP, transforms.mvp[slot]);
 	// Set M matrix uniform
-	glUniformMatrix4fv(cloud_eff.get_uniform_location("M"),
-		1,
-		GL_FALSE,
-		value_ptr(M));
+	set_uniform(u.M, transforms.world[slot]);
 	// Set N matrix uniform - remember - 3x3 matrix
-	glUniformMatrix3fv(cloud_eff.get_uniform_location("N"),
-		1,
-		GL_FALSE,
-		value_ptr(clouds.get_transform().get_normal_matrix()));
-	// Bind material
-	renderer::bind(clouds.get_material(), "mat");
-	// Bind light
-	renderer::bind(points, "points");
-	// Bind and set textures
-	renderer::bind(cloudsTex, 0);
-	glUniform1i(cloud_eff.get_uniform_location("tex"), 0);
-	// Bind normal_map
-	renderer::bind(normal_map, 1);
-	// Set normal_map uniform
-	glUniform1i(cloud_eff.get_uniform_location("normal_map"), 1);
-	// Set eye position- Get this from active camera
-	glUniform3fv(cloud_eff.get_uniform_location("eye_pos"), 1, value_ptr(cam_pos));
-	// Render mesh
-	renderer::render(clouds);
+	set_uniform(u.N, transforms.normal[slot]);
 }
 
-// Render the skybox
-void render_skybox(effect skybox_eff, 
-				   mesh stars, 
-				   cubemap cube_map, 
-				   mat4 PV)
+// Render a mesh into a layer of a shadow tile using its cached
+// light MVP and the detail level picked for the shadow pass,
+// skipping it if it is outside the light's frustum. The static
+// layer outlives the camera, so only moving casters are also
+// skipped when their shadow falls on nothing visible
+void render_shadow_caster(const uniform_handle<mat4> &MVP, mesh &m, const transform_cache &transforms,
+						  const lod_table &lods, const bounds_table &bounds, const shadow_cache &cache,
+						  int layer, unsigned int slot)
 {
-	// Disable depth test, depth mask, face culling
-	glDisable(GL_DEPTH_TEST);
-	glDepthMask(GL_FALSE);
-	glDisable(GL_CULL_FACE);
-	// Bind skybox effect
-	renderer::bind(skybox_eff);
-	// Calculate MVP for the skybox
-	auto MVP = PV * stars.get_transform().get_transform_matrix();
-	glUniformMatrix4fv(skybox_eff.get_uniform_location("MVP"), 1, GL_FALSE, value_ptr(MVP));
-	// Bind the cube map and set it
-	renderer::bind(cube_map, 0);
-	glUniform1i(skybox_eff.get_uniform_location("cubemap"), 0);
-	// Render the skybox
-	renderer::render(stars);
-	// Enable depth test, depth mask, face culling
-	glEnable(GL_DEPTH_TEST);
-	glDepthMask(GL_TRUE);
-	glEnable(GL_CULL_FACE);
-}
-
-// Render the basic planets etc.
-void render_solar_objects(effect eff,
-						  mesh m,
-						  texture tex, texture normal_map,
-						  shadow_map shadow, mat4 LightProjectionMat, 
-						  mat4 PV)
-{
-	// Create MVP matrix
-	auto M = m.get_transform().get_transform_matrix();
-	auto MVP = PV * M;
+	if (!in_shadow_layer(cache, slot, layer) || !is_visible(bounds, CULL_PASS_SHADOW, slot))
+		return;
+	if (layer != SHADOW_LAYER_STATIC && !casts_visible_shadow(bounds, slot))
+		return;
 	// Set MVP matrix uniform
-	glUniformMatrix4fv(eff.get_uniform_location("MVP"),
-		1,
-		GL_FALSE,
-		value_ptr(MVP));
-	// Set M matrix uniform
-	glUniformMatrix4fv(eff.get_uniform_location("M"),
-		1,
-		GL_FALSE,
-		value_ptr(M));
-	// Set N matrix uniform
-	glUniformMatrix3fv(eff.get_uniform_location("N"),
-		1,
-		GL_FALSE,
-		value_ptr(m.get_transform().get_normal_matrix()));
-	// Set lightMVP uniform
-	auto lightMVP = LightProjectionMat * shadow.get_view() * M;
-	glUniformMatrix4fv(eff.get_uniform_location("lightMVP"),
-		1,
-		GL_FALSE,
-		value_ptr(lightMVP));
-	// Bind material
-	renderer::bind(m.get_material(), "mat");
-	// Bind and set textures
-	renderer::bind(tex, 0);
-	glUniform1i(eff.get_uniform_location("tex"), 0);
-	// Bind and set normal_map
-	renderer::bind(normal_map, 1);
-	glUniform1i(eff.get_uniform_location("normal_map"), 1);
+	set_uniform(MVP, transforms.light_mvp[slot]);
 	// Render mesh
-	renderer::render(m);
+	auto geom = lod_geometry(lods, LOD_PASS_SHADOW, slot);
+	if (geom)
+		renderer::render(*geom);
+	else
+		renderer::render(m);
 }
 
-// Render the sun
-void render_sun(effect eff, 
-				mesh m, 
-				texture tex, texture normal_map, 
-				vector<point_light> points, vector<spot_light> spots, 
-				shadow_map shadow, mat4 LightProjectionMat, 
-			    mat4 PV, vec3 cam_pos, 
-				float explode_factor, float peak_factor, vec3 sun_activity)
+// Render a mesh into the dirty faces of a point light's cube map
+// that its bounds touch, all in one draw
+void render_omni_caster(const omni_shadow_uniforms &u, mesh &m, const transform_cache &transforms,
+						const lod_table &lods, const omni_shadow &omni, unsigned int slot)
 {
-	// Disable cull face
-	glDisable(GL_CULL_FACE);
-	// Bind sun effect
-	renderer::bind(eff);
-	// Create MVP matrix
-	auto M = m.get_transform().get_transform_matrix();
-	auto MVP = PV * M;
-	// Set MVP matrix uniform
-	glUniformMatrix4fv(eff.get_uniform_location("MVP"),
-		1,
-		GL_FALSE,
-		value_ptr(MVP));
-	// Set M matrix uniform
-	glUniformMatrix4fv(eff.get_uniform_location("M"),
-		1,
-		GL_FALSE,
-		value_ptr(M));
-	// Set N matrix uniform
-	glUniformMatrix3fv(eff.get_uniform_location("N"),
-		1,
-		GL_FALSE,
-		value_ptr(m.get_transform().get_normal_matrix()));
-	// Set lightMVP uniform
-	auto lightMVP = LightProjectionMat * shadow.get_view() * M;
-	glUniformMatrix4fv(eff.get_uniform_location("lightMVP"),
-		1,
-		GL_FALSE,
-		value_ptr(lightMVP));
-	// Bind light
-	renderer::bind(points, "points");
-	// Bind spot light
-	renderer::bind(spots, "spots");
-	// Bind material
-	renderer::bind(m.get_material(), "mat");
-	// Set eye position
-	glUniform3fv(eff.get_uniform_location("eye_pos"), 1, value_ptr(cam_pos));
-	// Bind and set texture
-	renderer::bind(tex, 0);
-	glUniform1i(eff.get_uniform_location("tex"), 0);
-	// Bind and set normal_map
-	renderer::bind(normal_map, 1);
-	glUniform1i(eff.get_uniform_location("normal_map"), 1);
-	// Bind and set shadow map texture
-	renderer::bind(shadow.buffer->get_depth(), 2);
-	glUniform1i(eff.get_uniform_location("shadow_map"), 2);
-	// Set explode factor uniform
-	glUniform1f(eff.get_uniform_location("explode_factor"), explode_factor);
-	// Set explode factor uniform
-	glUniform1f(eff.get_uniform_location("peak_factor"), peak_factor);
-	// Set explode factor uniform
-	glUniform3fv(eff.get_uniform_location("sun_activity"), 1, value_ptr(sun_activity));
+	int mask = slot < omni.masks.size() ? omni.masks[slot] & omni.dirty_faces : 0;
+	if (!mask)
+		return;
+	// Set M matrix uniform, the geometry shader projects each face
+	set_uniform(u.M, transforms.world[slot]);
+	set_uniform(u.face_mask, mask);
 	// Render mesh
-	renderer::render(m);
-	glEnable(GL_CULL_FACE);
+	auto geom = lod_geometry(lods, LOD_PASS_SHADOW, slot);
+	if (geom)
+		renderer::render(*geom);
+	else
+		renderer::render(m);
 }
 
-// Render Jupiter
-void render_jupiter(effect eff,
-					mesh m,
-					array<texture, 14> texs,
-					vector<point_light> points, vector<spot_light> spots,
-					shadow_map shadow, mat4 LightProjectionMat,
-					mat4 PV, vec3 cam_pos, 
-					float weather_factor)
+// Render every shadowed spot light into its tile of the atlas,
+// the main spot light into its cascades and the sun's point light
+// into its cube map. Static casters in the atlas come from the
+// cached layer, which is only rendered again when the cache is
+// dirty. The cascades follow the camera so are rendered in full.
+// Only the cube map faces something changed in are rendered
+void create_shadow_map(effect shadow_eff, const uniform_handle<mat4> &shadow_MVP,
+					   effect omni_eff, const omni_shadow_uniforms &omni_u,
+					   map<string, mesh> &solar_objects, map<string, unsigned int> &solar_slots,
+					   array<mesh, 7> &enterprise, array<unsigned int, 7> &enterprise_slots,
+					   array<mesh, 2> &motions, array<unsigned int, 2> &motions_slots,
+					   mesh &rama, unsigned int rama_slot,
+					   shadow_atlas &atlas, const shadow_cascades &cascades, omni_shadow &omni,
+					   transform_cache &transforms, const lod_table &lods, bounds_table &bounds, shadow_cache &cache)
 {
-	// Bind effect
-	renderer::bind(eff);
-	// Create MVP matrix
-	auto M = m.get_transform().get_transform_matrix();
-	auto MVP = PV * M;
-	// Set MVP matrix uniform
-	glUniformMatrix4fv(eff.get_uniform_location("MVP"),
-		1,
-		GL_FALSE,
-		value_ptr(MVP));
-	// Set M matrix uniform
-	glUniformMatrix4fv(eff.get_uniform_location("M"),
-		1,
-		GL_FALSE,
-		value_ptr(M));
-	// Set N matrix uniform
-	glUniformMatrix3fv(eff.get_uniform_location("N"),
-		1,
-		GL_FALSE,
-		value_ptr(m.get_transform().get_normal_matrix()));
-	// Set lightMVP uniform
-	auto lightMVP = LightProjectionMat * shadow.get_view() * M;
-	glUniformMatrix4fv(eff.get_uniform_location("lightMVP"),
-		1,
-		GL_FALSE,
-		value_ptr(lightMVP));
-	// Bind material
-	renderer::bind(m.get_material(), "mat");
-	// Bind light
-	renderer::bind(points, "points");
-	// Bind spot light
-	renderer::bind(spots, "spots");
-	// Decide which textures to bind
-	int tex1, tex2;
-	if (weather_factor < 0.07)
-	{
-		tex1 = 0;
-		tex2 = 1;
-	}
-	else if (weather_factor < 0.14)
-	{
-		tex1 = 1;
-		tex2 = 2;
-	}
-	else if (weather_factor < 0.21)
+	// Visit every caster and its slot
+	auto for_each_caster = [&](const function<void(mesh &, unsigned int)> &visit)
 	{
-		tex1 = 2;
-		tex2 = 3;
-	}
-	else if (weather_factor < 0.28)
+		// Enterprise (hierarchy already applied in the cache)
+		for (size_t i = 0; i < enterprise.size(); i++)
+			visit(enterprise[i], enterprise_slots[i]);
+		// Nacelle domes
+		for (size_t i = 0; i < motions.size(); i++)
+			visit(motions[i], motions_slots[i]);
+		// Solar objects
+		for (auto &e : solar_objects)
+			visit(e.second, solar_slots[e.first]);
+		// Rama
+		visit(rama, rama_slot);
+	};
+	// Draw every caster in a layer
+	auto render_layer = [&](int layer)
 	{
-		tex1 = 3;
-		tex2 = 4;
-	}
-	else if (weather_factor < 0.35)
-	{
-		tex1 = 4;
-		tex2 = 5;
-	}
-	else if (weather_factor < 0.42)
-	{
-		tex1 = 5;
-		tex2 = 6;
-	}
-	else if (weather_factor < 0.49)
-	{
-		tex1 = 6;
-		tex2 = 7;
-	}
-	else if (weather_factor < 0.56)
-	{
-		tex1 = 7;
-		tex2 = 8;
-	}
-	else if (weather_factor < 0.63)
-	{
-		tex1 = 8;
-		tex2 = 9;
-	}
-	else if (weather_factor < 0.70)
-	{
-		tex1 = 9;
-		tex2 = 10;
-	}
-	else if (weather_factor < 0.77)
+		for_each_caster([&](mesh &m, unsigned int slot)
+		{
+			render_shadow_caster(shadow_MVP, m, transforms, lods, bounds, cache, layer, slot);
+		});
+	};
+	// Set face cull mode to front
+	glCullFace(GL_FRONT);
+	// Bind shader
+	renderer::bind(shadow_eff);
+	// Keep each light's draws and clears inside its tile
+	glEnable(GL_SCISSOR_TEST);
+	cull_stats shadow_stats;
+	for (auto &tile : atlas.tiles)
 	{
-		tex1 = 10;
-		tex2 = 11;
+		auto &light = *atlas.lights[tile.light].light;
+		// Light MVP of every caster for this light
+		update_light_transforms(transforms, tile.light_PV);
+		// Casters in the light's frustum that shadow something visible
+		cull_pass(bounds, CULL_PASS_SHADOW, tile.light_PV);
+		cull_shadow_receivers(bounds, light.get_position(), SHADOW_FAR);
+		shadow_stats.tested += bounds.stats[CULL_PASS_SHADOW].tested;
+		shadow_stats.visible += bounds.stats[CULL_PASS_SHADOW].visible;
+		glViewport(tile.origin.x, tile.origin.y, tile.size, tile.size);
+		glScissor(tile.origin.x, tile.origin.y, tile.size, tile.size);
+		// Render the static casters again if anything invalidated them
+		if (cache.dirty)
+		{
+			glBindFramebuffer(GL_FRAMEBUFFER, cache.buffer);
+			glClear(GL_DEPTH_BUFFER_BIT);
+			render_layer(SHADOW_LAYER_STATIC);
+		}
+		// Start from the static layer
+		composite_static_layer(cache, atlas, tile);
+		// Draw the moving casters over it
+		glBindFramebuffer(GL_FRAMEBUFFER, atlas.buffer);
+		render_layer(SHADOW_LAYER_DYNAMIC);
 	}
-	else if (weather_factor < 0.84)
+	glDisable(GL_SCISSOR_TEST);
+	// One layer of the array per cascade
+	glBindFramebuffer(GL_FRAMEBUFFER, cascades.buffer);
+	glViewport(0, 0, cascades.size, cascades.size);
+	for (unsigned int c = 0; c < cascades.count; ++c)
 	{
-		tex1 = 11;
-		tex2 = 12;
+		glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, cascades.depth, 0, c);
+		glClear(GL_DEPTH_BUFFER_BIT);
+		update_light_transforms(transforms, cascades.light_PV[c]);
+		cull_pass(bounds, CULL_PASS_SHADOW, cascades.light_PV[c]);
+		cull_shadow_receivers(bounds, cascades.light->get_position(), SHADOW_FAR);
+		shadow_stats.tested += bounds.stats[CULL_PASS_SHADOW].tested;
+		shadow_stats.visible += bounds.stats[CULL_PASS_SHADOW].visible;
+		render_layer(SHADOW_LAYER_ALL);
 	}
-	else if (weather_factor < 0.91)
+	bounds.stats[CULL_PASS_SHADOW] = shadow_stats;
+	if (cache.dirty)
 	{
-		tex1 = 12;
-		tex2 = 13;
+		cache.dirty = false;
+		++cache.rebuilds;
 	}
-	else
+	// Every dirty face of the cube map in a single pass
+	if (omni.dirty_faces)
 	{
-		tex1 = 13;
-		tex2 = 0;
+		glBindFramebuffer(GL_FRAMEBUFFER, omni.buffer);
+		glViewport(0, 0, omni.size, omni.size);
+		clear_omni_faces(omni);
+		renderer::bind(omni_eff);
+		for (int f = 0; f < 6; ++f)
+			set_uniform(omni_u.face_PV[f], omni.face_PV[f]);
+		set_uniform(omni_u.light_pos, omni.position);
+		set_uniform(omni_u.far_plane, omni.far_plane);
+		for_each_caster([&](mesh &m, unsigned int slot)
+		{
+			render_omni_caster(omni_u, m, transforms, lods, omni, slot);
+		});
+		for (int f = 0; f < 6; ++f)
+			omni.face_renders += (omni.dirty_faces >> f) & 1;
+		omni.dirty_faces = 0;
 	}
-	// Bind and set textures
-	renderer::bind(texs[tex1], 0);
-	renderer::bind(texs[tex2], 1);
-	glUniform1i(eff.get_uniform_location("tex[0]"), 0);
-	glUniform1i(eff.get_uniform_location("tex[1]"), 1);
-	// Set eye position- Get this from active camera
-	glUniform3fv(eff.get_uniform_location("eye_pos"), 1, value_ptr(cam_pos));
-	// Bind and set shadow map texture
-	renderer::bind(shadow.buffer->get_depth(), 2);
-	glUniform1i(eff.get_uniform_location("shadow_map"), 2);
-	// Render mesh
-	renderer::render(m);
+	// Set render target back to the screen
+	renderer::set_render_target();
+	// Set face cull mode to back
+	glCullFace(GL_BACK);
 }
 
-// Render the Enterprise (transform hierarchy)
-void render_enterprise(effect ship_eff, 
-					   array<mesh, 7> enterprise, array<mesh, 2> motions,
-					   texture tex, texture normal_map, array<texture, 2> motions_textures,
-					   vector<point_light> points, vector<spot_light> spots,
-					   shadow_map shadow, mat4 &LightProjectionMat, 
-					   mat4 PV, vec3 cam_pos)
+// Handles to the uniforms that make the sun's surface move
+struct sun_activity_uniforms
 {
-	// Bind effect
-	renderer::bind(ship_eff);
-	// Set the texture value for the shader here
-	glUniform1i(ship_eff.get_uniform_location("tex"), 0);
-	// Bind material
-	renderer::bind(enterprise[0].get_material(), "mat");
-	// Bind point light
-	renderer::bind(points, "points");
-	// Bind spot light
-	renderer::bind(spots, "spots");
-	// Bind texture to renderer
-	renderer::bind(tex, 0);
-	// Bind normal_map
-	renderer::bind(normal_map, 1);
-	// Set normal_map uniform
-	glUniform1i(ship_eff.get_uniform_location("normal_map"), 1);
-	// Set eye position
-	glUniform3fv(ship_eff.get_uniform_location("eye_pos"), 1, value_ptr(cam_pos));
-	// Bind shadow map texture
-	renderer::bind(shadow.buffer->get_depth(), 2);
-	// Set the shadow_map uniform
-	glUniform1i(ship_eff.get_uniform_location("shadow_map"), 2);
-	// Find the lcoation for the MVP uniform
-	const auto loc = ship_eff.get_uniform_location("MVP");
-	// Render Enterprise
-	for (size_t i = 0; i < enterprise.size(); i++) {
-		// SET M to be the usual mesh  transform matrix
-		auto M = enterprise[i].get_transform().get_transform_matrix();
-		// Apply the heirarchy chain
-		for (size_t j = i; j > 0; j--) {
-			M = enterprise[j - 1].get_transform().get_transform_matrix() * M;
-		}
-		// Set MVP matrix uniform
-		glUniformMatrix4fv(loc, 1, GL_FALSE, value_ptr(PV * M));
-		// Set M matrix uniform
-		glUniformMatrix4fv(ship_eff.get_uniform_location("M"), 1, GL_FALSE, value_ptr(M));
-		// Set N matrix uniform
-		glUniformMatrix3fv(ship_eff.get_uniform_location("N"), 1, GL_FALSE,
-			value_ptr(enterprise[i].get_transform().get_normal_matrix()));
-		// Set lightMVP uniform
-		auto lightMVP = LightProjectionMat * shadow.get_view() * M;
-		glUniformMatrix4fv(ship_eff.get_uniform_location("lightMVP"),
-			1,
-			GL_FALSE,
-			value_ptr(lightMVP));
-		// Render mesh
-		renderer::render(enterprise[i]);
-	}
-	// Bind material
-	renderer::bind(motions[0].get_material(), "mat");
-	// Bind texture
-	renderer::bind(motions_textures[0], 0);
-	for (int i = 0; i < motions.size(); i++)
-	{
-		auto M = motions[i].get_transform().get_transform_matrix();
-		glUniformMatrix4fv(loc, 1, GL_FALSE, value_ptr(PV * M));
-		// Set M matrix uniform
-		glUniformMatrix4fv(ship_eff.get_uniform_location("M"), 1, GL_FALSE, value_ptr(M));
-		// Set N matrix uniform
-		glUniformMatrix3fv(ship_eff.get_uniform_location("N"), 1, GL_FALSE,
-			value_ptr(motions[i].get_transform().get_normal_matrix()));
-		// Set lightMVP uniform
-		auto lightMVP = LightProjectionMat * shadow.get_view() * M;
-		glUniformMatrix4fv(ship_eff.get_uniform_location("lightMVP"),
-			1,
-			GL_FALSE,
-			value_ptr(lightMVP));
-		renderer::render(motions[i]);
-	}
+	uniform_handle<float> explode_factor;
+	uniform_handle<float> peak_factor;
+	uniform_handle<vec3> sun_activity;
+};
+
+// Resolve the sun activity uniforms of an effect
+sun_activity_uniforms get_sun_activity_uniforms(const uniform_table &table)
+{
+	sun_activity_uniforms u;
+	u.explode_factor = get_handle<float>(table, "explode_factor");
+	u.peak_factor = get_handle<float>(table, "peak_factor");
+	u.sun_activity = get_handle<vec3>(table, "sun_activity");
+	return u;
 }
 
+// Set the uniforms that make the sun's surface move
+void bind_sun_activity(const sun_activity_uniforms &u, float explode_factor, float peak_factor, vec3 sun_activity)
+{
+	// Set explode factor uniform
+	set_uniform(u.explode_factor, explode_factor);
+	// Set peak factor uniform
+	set_uniform(u.peak_factor, peak_factor);
+	// Set sun activity uniform
+	set_uniform(u.sun_activity, sun_activity);
+}
 
-// Render Rama
-void render_rama(effect outside_eff, effect inside_eff, effect terrain_eff,
-				 mesh rama, array<mesh, 6> rama_terrain,
-				 texture inside, texture outside, texture grass, texture blend_map, texture normal_outside, texture normal_inside, material mat_inside,
-				 array<texture, 4> terrain_texs,
-				 vector<point_light> points, vector<spot_light> spots, vector<point_light> points_rama, vector<spot_light> spots_rama,
-				 shadow_map shadow, mat4 &LightProjectionMat, 
-				 mat4 PV, mat4 V, vec3 cam_pos)
+// Pick which of the 14 Jupiter texture pairs to blend
+// The weather moves on to the next pair every 0.07
+unsigned int jupiter_weather_index(float weather_factor)
 {
-	// Bind effect
-	renderer::bind(outside_eff);
-	// Create MVP matrix
-	auto M = rama.get_transform().get_transform_matrix();
-	auto MVP = PV * M;
-	// Set MVP matrix uniform
-	glUniformMatrix4fv(outside_eff.get_uniform_location("MVP"), 1, GL_FALSE, value_ptr(MVP));
-	// Set M matrix uniform
-	glUniformMatrix4fv(outside_eff.get_uniform_location("M"), 1, GL_FALSE, value_ptr(M));
-	// Set N matrix uniform
-	glUniformMatrix3fv(outside_eff.get_uniform_location("N"), 1, GL_FALSE,
-		value_ptr(rama.get_transform().get_normal_matrix()));
-	// Set lightMVP uniform
-	auto lightMVP = LightProjectionMat * shadow.get_view() * M;
-	glUniformMatrix4fv(outside_eff.get_uniform_location("lightMVP"),
-		1,
-		GL_FALSE,
-		value_ptr(lightMVP));
-	// Bind material
-	renderer::bind(rama.get_material(), "mat");
-	// Bind light
-	renderer::bind(points, "points");
-	renderer::bind(spots, "spots");
-	// Bind textures
-	renderer::bind(outside, 0);
-	renderer::bind(grass, 1);
-	// Bind blend map
-	renderer::bind(blend_map, 2);
-	// Set the uniform values for textures
-	static int tex_indices[] = { 0, 1 };
-	// Set tex uniform
-	glUniform1iv(outside_eff.get_uniform_location("tex"), 2, tex_indices);
-	// Set blend map uniform
-	glUniform1i(outside_eff.get_uniform_location("blend_map"), 2);
-	// Bind normal_map
-	renderer::bind(normal_outside, 3);
-	// Set normal_map uniform
-	glUniform1i(outside_eff.get_uniform_location("normal_map"), 3);
-	// Set eye position
-	glUniform3fv(outside_eff.get_uniform_location("eye_pos"), 1, value_ptr(cam_pos));
-	// Bind shadow map texture
-	renderer::bind(shadow.buffer->get_depth(), 4);
-	// Set the shadow_map uniform
-	glUniform1i(outside_eff.get_uniform_location("shadow_map"), 4);
-	// Render mesh
-	renderer::render(rama);
-	
-	// Disable face culling
-	glDisable(GL_CULL_FACE);
-	// Bind effect
-	renderer::bind(inside_eff);
-	// Create MV matrix
-	auto MV = V * M;
-	// Set MVP matrix uniform
-	glUniformMatrix4fv(inside_eff.get_uniform_location("MVP"), 1, GL_FALSE, value_ptr(MVP));
-	// Set MV matrix uniform
-	glUniformMatrix4fv(inside_eff.get_uniform_location("MV"), 1, GL_FALSE, value_ptr(MV));
-	// Set M matrix uniform
-	glUniformMatrix4fv(inside_eff.get_uniform_location("M"), 1, GL_FALSE, value_ptr(M));
-	// Set N matrix uniform
-	glUniformMatrix3fv(inside_eff.get_uniform_location("N"), 1, GL_FALSE,
-		value_ptr(rama.get_transform().get_normal_matrix()));
-	// Set lightMVP uniform
-	glUniformMatrix4fv(inside_eff.get_uniform_location("lightMVP"),
-		1,
-		GL_FALSE,
-		value_ptr(lightMVP));
-	// Bind material
-	renderer::bind(mat_inside, "mat");
-	// Bind light
-	renderer::bind(points_rama, "points");
-	// Bind light
-	renderer::bind(spots_rama, "spots");
-	// Bind texture
-	renderer::bind(inside, 0);
-	// Set tex uniform
-	glUniform1i(inside_eff.get_uniform_location("tex"), 0);
-	// Bind normal_map
-	renderer::bind(normal_inside, 1);
-	// Set normal_map uniform
-	glUniform1i(inside_eff.get_uniform_location("normal_map"), 1);
-	// Set fog colour
-	glUniform4fv(inside_eff.get_uniform_location("fog_colour"), 1, value_ptr(vec4(0.412f, 1.0f, 0.996f, 1.0f)));
-	// Set fog start:  5.0f
-	glUniform1f(inside_eff.get_uniform_location("fog_start"), 5.0f);
-	// Set fog end:  100.0f
-	glUniform1f(inside_eff.get_uniform_location("fog_end"), 100.0f);
-	// Set fog density: 0.04f
-	glUniform1f(inside_eff.get_uniform_location("fog_density"), 0.04f);
-	// Set fog type: FOG_EXP2
-	glUniform1i(inside_eff.get_uniform_location("fog_type"), FOG_EXP2);
-	renderer::render(rama);
-	glEnable(GL_CULL_FACE);
+	return std::min(static_cast<unsigned int>(weather_factor / 0.07f), 13u);
 }
 
-void render_terrain_cube(effect terrain_eff,
-	mesh cube_terrain,
-	array<texture, 4> terrain_texs,
-	vector<point_light> points, vector<spot_light> spots,
-	shadow_map shadow, mat4 &LightProjectionMat,
-	mat4 PV, mat4 V, vec3 cam_pos)
+// Handles to the uniforms of the particle compute effect
+struct particle_uniforms
 {
-	// Bind effect
-	renderer::bind(terrain_eff);
-	// Set the texture value for the shader here
-	glUniform1i(terrain_eff.get_uniform_location("tex[0]"), 0);
-	glUniform1i(terrain_eff.get_uniform_location("tex[1]"), 1);
-	glUniform1i(terrain_eff.get_uniform_location("tex[2]"), 2);
-	glUniform1i(terrain_eff.get_uniform_location("tex[3]"), 3);
-	// Find the lcoation for the MVP uniform
-	const auto loc = terrain_eff.get_uniform_location("MVP");
-	// Bind material
-	renderer::bind(cube_terrain.get_material(), "mat");
-	// Bind point light
-	renderer::bind(points, "points");
-	// Bind spot light
-	renderer::bind(spots, "spots");
-	// Bind textures to renderer
-	renderer::bind(terrain_texs[0], 0);
-	renderer::bind(terrain_texs[1], 1);
-	renderer::bind(terrain_texs[2], 2);
-	renderer::bind(terrain_texs[3], 3);
-	// Set fog colour
-	glUniform4fv(terrain_eff.get_uniform_location("fog_colour"), 1, value_ptr(vec4(0.412f, 1.0f, 0.996f, 1.0f)));
-	// Set fog start:  5.0f
-	glUniform1f(terrain_eff.get_uniform_location("fog_start"), 5.0f);
-	// Set fog end:  100.0f
-	glUniform1f(terrain_eff.get_uniform_location("fog_end"), 100.0f);
-	// Set fog density: 0.04f
-	glUniform1f(terrain_eff.get_uniform_location("fog_density"), 0.04f);
-	// Set fog type: FOG_EXP2
-	glUniform1i(terrain_eff.get_uniform_location("fog_type"), FOG_EXP2);
-	// Set eye position
-	glUniform3fv(terrain_eff.get_uniform_location("eye_pos"), 1, value_ptr(cam_pos));
-	auto M = cube_terrain.get_transform().get_transform_matrix();
-	// Set MVP matrix uniform
-	glUniformMatrix4fv(loc, 1, GL_FALSE, value_ptr(PV * M));
-	// Set M matrix uniform
-	glUniformMatrix4fv(terrain_eff.get_uniform_location("M"), 1, GL_FALSE, value_ptr(M));
-	// Set MV matrix uniform
-	glUniformMatrix4fv(terrain_eff.get_uniform_location("MV"), 1, GL_FALSE, value_ptr(V * M));
-	// Set N matrix uniform
-	glUniformMatrix3fv(terrain_eff.get_uniform_location("N"), 1, GL_FALSE,
-	value_ptr(cube_terrain.get_transform().get_normal_matrix()));
-	// Set lightMVP uniform
-	auto lightMVP = LightProjectionMat * shadow.get_view() * M;
-	glUniformMatrix4fv(terrain_eff.get_uniform_location("lightMVP"),
-		1,
-		GL_FALSE,
-		value_ptr(lightMVP));
-	// Bind shadow map texture
-	renderer::bind(shadow.buffer->get_depth(), 4);
-	// Set the shadow_map uniform
-	glUniform1i(terrain_eff.get_uniform_location("shadow_map"), 4);
-	// Render mesh
-	renderer::render(cube_terrain);
+	uniform_handle<float> delta_time;
+	uniform_handle<vec3> max_dims;
+};
+
+// Resolve the particle uniforms from the compute effect
+particle_uniforms get_particle_uniforms(const uniform_table &compute_table)
+{
+	particle_uniforms u;
+	u.delta_time = get_handle<float>(compute_table, "delta_time");
+	u.max_dims = get_handle<vec3>(compute_table, "max_dims");
+	return u;
 }
 
-// Render asteroid particles
-void render_particles(effect compute_eff, effect eff,
-					  const unsigned int MAX_PARTICLES, GLuint G_Position_buffer, GLuint G_Velocity_buffer,
-					  mat4 M, mat4 PV)
+// Move the asteroid particles, they are drawn as billboards
+// straight from the buffers (billboards.h)
+void update_particles(effect compute_eff, const unsigned int MAX_PARTICLES, GLuint G_Position_buffer, GLuint G_Velocity_buffer)
 {
 	// Bind Compute Shader
 	renderer::bind(compute_eff);
 	// Bind data as SSBO
 	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, G_Position_buffer);
 	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, G_Velocity_buffer);
-	// Dispatch
-	glDispatchCompute(MAX_PARTICLES / 128, 1, 1);
-	// Sync, wait for completion
-	glMemoryBarrier(GL_ALL_BARRIER_BITS);
+	// Dispatch, rounding up to whole blocks
+	glDispatchCompute((MAX_PARTICLES + 127) / 128, 1, 1);
+	// Sync, the billboards read the positions next
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
-	// Bind render effect
-	renderer::bind(eff);
-	// Create MVP matrix
-	auto MVP = PV * M;
-	// Set the colour uniform
-	glUniform4fv(eff.get_uniform_location("colour"), 1, value_ptr(vec4(0.3f, 0.4f, 0.52f, 0.75f)));
-	// Set MVP matrix uniform
-	glUniformMatrix4fv(eff.get_uniform_location("MVP"), 1, GL_FALSE, value_ptr(MVP));
-	// Bind position buffer as GL_ARRAY_BUFFER
-	glBindBuffer(GL_ARRAY_BUFFER, G_Position_buffer);
-	// Setup vertex format
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, (void *)0);
-	// Render
-	glDrawArrays(GL_POINTS, 0, MAX_PARTICLES);
-	// Tidy up
-	glDisableVertexAttribArray(0);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glUseProgram(0);
-}
\ No newline at end of file
+}
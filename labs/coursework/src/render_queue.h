@@ -0,0 +1,497 @@
+// render_queue.h - Header file containing the render queue
+// Draws are submitted with a packed 64-bit sort key, radix sorted
+// once per frame and then issued in order, binding each effect and
+// texture set only when it changes
+// Key layout (most significant first):
+//   opaque/background - pass(2) effect(10) texture set(16) depth(32)
+//   transparent       - pass(2) inverted depth(32) effect(10) texture set(16)
+// so opaques are grouped by state then drawn front-to-back for
+// early-z, the background only fills what they left uncovered and
+// transparents are drawn back-to-front
+// The overdraw view (see overdraw.h) draws the same sorted items
+// with counting effects in place of every effect
+// With the depth prepass on, the opaques of effects that opt in are
+// first drawn depth-only and then shaded with GL_EQUAL, so their
+// fragment shaders run once per visible pixel. Batches join it
+// through their own depth-only effect
+// A batch item hands drawing back to its owner once its effect is
+// bound, which is how instanced draws join the queue
+// An effect can have a deferred variant that writes the G-buffer
+// (see deferred.h). While the queue is deferred, opaque draws of
+// the effect are submitted with the variant instead
+// Last modified - 18/10/2026
+
+#pragma once
+
+#include <glm\glm.hpp>
+#include <graphics_framework.h>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <unordered_map>
+#include "transform_cache.h"
+#include "render_helpers.h"
+#include "uniform_table.h"
+
+using namespace std;
+using namespace graphics_framework;
+using namespace glm;
+
+// Render passes, in submission order
+#define PASS_OPAQUE 0
+#define PASS_BACKGROUND 1
+#define PASS_TRANSPARENT 2
+
+struct render_queue;
+
+// An effect and the state it needs set when it is first bound
+struct queue_effect
+{
+	effect eff;
+	// Active uniforms of the effect
+	uniform_table uniforms;
+	// Resolved transform uniforms
+	transform_uniforms transforms;
+	// Resolved sampler uniforms for each texture set, filled the
+	// first time a set is drawn with this effect
+	vector<vector<uniform_handle<int>>> samplers;
+	// Called after the effect is bound
+	function<void(effect &eff, const render_queue &queue)> begin;
+	// Called before another effect is bound (may be empty)
+	function<void()> end;
+	// Effect drawn instead while the queue is deferred, -1 for none
+	int deferred = -1;
+	// Does this effect write the G-buffer
+	bool gbuffer = false;
+	// Material table entry uniform of a G-buffer effect
+	uniform_handle<int> material_id;
+	// Do the effect's opaque draws join the depth prepass. Only for
+	// effects whose vertex shader matches depth_prepass.vert and
+	// that draw with back faces culled
+	bool prepass = false;
+	// Rough cost of a fragment next to the other effects, counting
+	// lights, texture fetches and shadow lookups
+	int cost = 1;
+	// Is the effect drawn without face culling
+	bool two_sided = false;
+};
+
+// Effects every draw is switched to while counting overdraw
+struct count_effects
+{
+	// For meshes and for instanced batches
+	effect mesh_eff;
+	effect batch_eff;
+	uniform_handle<mat4> MVP;
+	uniform_handle<int> far_plane;
+	uniform_handle<int> mesh_cost;
+	uniform_handle<int> batch_cost;
+	// Add each effect's cost per fragment rather than 1
+	bool weighted = false;
+};
+
+// Textures bound together, texture i goes to unit i
+struct texture_set
+{
+	vector<texture> textures;
+	// Sampler uniform for each texture
+	vector<string> names;
+};
+
+// A single queued draw
+struct render_item
+{
+	uint64_t key;
+	// Batch to call instead of drawing a mesh, -1 for a mesh
+	int batch;
+	mesh *m;
+	// Detail level to draw instead of the mesh's own geometry
+	const geometry *geom;
+	material *mat;
+	unsigned int slot;
+	unsigned int effect_id;
+	unsigned int texture_set;
+};
+
+// Pass, effect and textures an object is drawn with
+struct draw_info
+{
+	unsigned int pass;
+	unsigned int effect_id;
+	unsigned int texture_set;
+};
+
+// Per-frame queue of draws plus the effects and texture sets they use
+struct render_queue
+{
+	vector<queue_effect> effects;
+	vector<texture_set> texture_sets;
+	// Batches that draw themselves once their effect is bound
+	vector<function<void(queue_effect &e)>> batches;
+	vector<render_item> items;
+	// Scratch buffer for the radix sort
+	vector<render_item> scratch;
+	// Camera for this frame
+	mat4 V;
+	vec3 cam_pos;
+	// Submit opaque draws with their G-buffer variants
+	bool deferred = false;
+	// Materials drawn into the G-buffer and the id each was given
+	vector<material*> materials;
+	unordered_map<material*, int> material_ids;
+	// Lay down the depth of opaque draws before shading them
+	bool depth_prepass = false;
+	effect prepass_eff;
+	uniform_handle<mat4> prepass_MVP;
+	// Depth-only effect the batches draw through
+	effect prepass_batch_eff;
+	// Counting effects of the overdraw view
+	count_effects counters;
+};
+
+// Register an effect and its uniform table with the queue, returns its id
+unsigned int add_queue_effect(render_queue &queue, effect eff, const uniform_table &uniforms,
+							  function<void(effect &, const render_queue &)> begin,
+							  function<void()> end = nullptr)
+{
+	queue_effect e;
+	e.eff = eff;
+	e.uniforms = uniforms;
+	e.transforms = get_transform_uniforms(uniforms);
+	e.begin = begin;
+	e.end = end;
+	queue.effects.push_back(e);
+	return static_cast<unsigned int>(queue.effects.size() - 1);
+}
+
+// Register the G-buffer variant of an effect, drawn in its place
+// while the queue is deferred, returns its id
+unsigned int add_deferred_variant(render_queue &queue, unsigned int effect_id, effect eff, const uniform_table &uniforms,
+								  function<void(effect &, const render_queue &)> begin = nullptr,
+								  function<void()> end = nullptr)
+{
+	unsigned int id = add_queue_effect(queue, eff, uniforms, begin, end);
+	queue.effects[id].gbuffer = true;
+	queue.effects[id].material_id = get_handle<int>(uniforms, "material_id");
+	queue.effects[effect_id].deferred = static_cast<int>(id);
+	return id;
+}
+
+// Set the depth-only effects the prepass draws meshes and batches with
+void set_prepass_effect(render_queue &queue, effect eff, const uniform_table &uniforms, effect batch_eff)
+{
+	queue.prepass_eff = eff;
+	queue.prepass_MVP = get_handle<mat4>(uniforms, "MVP");
+	queue.prepass_batch_eff = batch_eff;
+}
+
+// Register a set of textures with the queue, returns its id
+unsigned int add_texture_set(render_queue &queue, vector<texture> textures, vector<string> names)
+{
+	texture_set t;
+	t.textures = textures;
+	t.names = names;
+	queue.texture_sets.push_back(t);
+	return static_cast<unsigned int>(queue.texture_sets.size() - 1);
+}
+
+// Register a batch with the queue, returns its id
+unsigned int add_queue_batch(render_queue &queue, function<void(queue_effect &e)> draw)
+{
+	queue.batches.push_back(draw);
+	return static_cast<unsigned int>(queue.batches.size() - 1);
+}
+
+// Pack a sort key for a draw
+uint64_t make_sort_key(unsigned int pass, unsigned int effect_id, unsigned int texture_set, float depth)
+{
+	// Bit pattern of a positive float sorts the same as its value
+	uint32_t depth_bits;
+	depth = std::max(depth, 0.0f);
+	memcpy(&depth_bits, &depth, sizeof(depth_bits));
+	uint64_t state = (static_cast<uint64_t>(effect_id & 0x3FF) << 16) | (texture_set & 0xFFFF);
+	uint64_t key = static_cast<uint64_t>(pass & 0x3) << 62;
+	if (pass == PASS_TRANSPARENT)
+		return key | (static_cast<uint64_t>(~depth_bits) << 26) | state;
+	return key | (state << 32) | depth_bits;
+}
+
+// Clear the queue for a new frame
+void begin_queue(render_queue &queue, const mat4 &V, const vec3 &cam_pos)
+{
+	queue.items.clear();
+	queue.V = V;
+	queue.cam_pos = cam_pos;
+}
+
+// Add a draw to the queue
+void submit(render_queue &queue, unsigned int pass, unsigned int effect_id, unsigned int texture_set,
+			mesh &m, material &mat, unsigned int slot, const transform_cache &transforms,
+			const geometry *geom = nullptr)
+{
+	render_item item;
+	// Opaque surfaces go through the G-buffer when they can
+	if (queue.deferred && pass == PASS_OPAQUE && queue.effects[effect_id].deferred >= 0)
+		effect_id = queue.effects[effect_id].deferred;
+	// Distance from the camera to the object's origin
+	float depth = distance(queue.cam_pos, vec3(transforms.world[slot][3]));
+	item.key = make_sort_key(pass, effect_id, texture_set, depth);
+	item.batch = -1;
+	item.m = &m;
+	item.geom = geom;
+	item.mat = &mat;
+	item.slot = slot;
+	item.effect_id = effect_id;
+	item.texture_set = texture_set;
+	queue.items.push_back(item);
+}
+
+// Add a batch draw to the queue at the given depth
+void submit_batch(render_queue &queue, unsigned int pass, unsigned int effect_id, unsigned int batch, float depth)
+{
+	render_item item;
+	// Batches bind their own textures
+	item.key = make_sort_key(pass, effect_id, 0xFFFF, depth);
+	item.batch = static_cast<int>(batch);
+	item.m = nullptr;
+	item.geom = nullptr;
+	item.mat = nullptr;
+	item.slot = 0;
+	item.effect_id = effect_id;
+	item.texture_set = 0;
+	queue.items.push_back(item);
+}
+
+// LSD radix sort of the items by key, 8 bits per pass
+// Passes where every key has the same byte are skipped
+void radix_sort(vector<render_item> &items, vector<render_item> &scratch)
+{
+	scratch.resize(items.size());
+	for (unsigned int shift = 0; shift < 64; shift += 8)
+	{
+		// Count each byte value
+		size_t counts[256] = { 0 };
+		for (auto &item : items)
+			++counts[(item.key >> shift) & 0xFF];
+		// Nothing to do if all keys share this byte
+		if (counts[(items[0].key >> shift) & 0xFF] == items.size())
+			continue;
+		// Turn counts into offsets
+		size_t offset = 0;
+		for (auto &c : counts)
+		{
+			size_t n = c;
+			c = offset;
+			offset += n;
+		}
+		// Scatter, keeping the order of equal bytes
+		for (auto &item : items)
+			scratch[counts[(item.key >> shift) & 0xFF]++] = item;
+		items.swap(scratch);
+	}
+}
+
+// Bind a set of textures to the current effect
+void bind_texture_set(queue_effect &e, unsigned int set_id, const texture_set &set)
+{
+	// Resolve the samplers the first time this pair is seen
+	if (e.samplers.size() <= set_id)
+		e.samplers.resize(set_id + 1);
+	auto &samplers = e.samplers[set_id];
+	if (samplers.size() != set.names.size())
+	{
+		samplers.clear();
+		for (auto &name : set.names)
+			samplers.push_back(get_handle<int>(e.uniforms, name));
+	}
+	for (size_t i = 0; i < set.textures.size(); ++i)
+	{
+		renderer::bind(set.textures[i], static_cast<int>(i));
+		set_uniform(samplers[i], static_cast<int>(i));
+	}
+}
+
+// Is an item drawn into the G-buffer
+bool is_gbuffer_item(const render_queue &queue, const render_item &item)
+{
+	return queue.effects[item.effect_id].gbuffer;
+}
+
+// Id of a material in the frame's material table, adding it if new
+int material_table_id(render_queue &queue, material *mat)
+{
+	auto found = queue.material_ids.find(mat);
+	if (found != queue.material_ids.end())
+		return found->second;
+	int id = static_cast<int>(queue.materials.size());
+	queue.materials.push_back(mat);
+	queue.material_ids[mat] = id;
+	return id;
+}
+
+// Sort the queue's items by key
+void sort_queue(render_queue &queue)
+{
+	if (!queue.items.empty())
+		radix_sort(queue.items, queue.scratch);
+}
+
+// Is an item drawn depth-only before it is shaded
+bool is_prepass_item(const render_queue &queue, const render_item &item)
+{
+	return queue.depth_prepass && item.key >> 62 == PASS_OPAQUE && queue.effects[item.effect_id].prepass;
+}
+
+// Draw the depth of the sorted prepass items, front-to-back within
+// each effect
+void draw_depth_prepass(render_queue &queue, const transform_cache &transforms)
+{
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	// Swap between the mesh and batch effects only when needed
+	int current = -1;
+	for (auto &item : queue.items)
+	{
+		if (!is_prepass_item(queue, item))
+			continue;
+		int wanted = item.batch >= 0 ? 1 : 0;
+		if (wanted != current)
+		{
+			renderer::bind(wanted ? queue.prepass_batch_eff : queue.prepass_eff);
+			current = wanted;
+		}
+		// Batches draw themselves through the depth-only effect
+		if (item.batch >= 0)
+		{
+			queue.batches[item.batch](queue.effects[item.effect_id]);
+			continue;
+		}
+		set_uniform(queue.prepass_MVP, transforms.mvp[item.slot]);
+		if (item.geom)
+			renderer::render(*item.geom);
+		else
+			renderer::render(*item.m);
+	}
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
+
+// Issue the sorted draws that pass a filter, in order
+void draw_queue(render_queue &queue, const transform_cache &transforms,
+				function<bool(const render_item &item)> filter = nullptr)
+{
+	// Nothing is bound yet
+	int current_effect = -1;
+	int current_textures = -1;
+	for (auto &item : queue.items)
+	{
+		if (filter && !filter(item))
+			continue;
+		// Change effect only when needed
+		if (static_cast<int>(item.effect_id) != current_effect)
+		{
+			if (current_effect >= 0 && queue.effects[current_effect].end)
+				queue.effects[current_effect].end();
+			current_effect = item.effect_id;
+			current_textures = -1;
+			auto &e = queue.effects[current_effect];
+			renderer::bind(e.eff);
+			// Prepassed draws only shade the depth they laid down
+			bool equal = is_prepass_item(queue, item);
+			glDepthFunc(equal ? GL_EQUAL : GL_LESS);
+			glDepthMask(equal ? GL_FALSE : GL_TRUE);
+			if (e.begin)
+				e.begin(e.eff, queue);
+		}
+		auto &e = queue.effects[current_effect];
+		// Batches draw themselves
+		if (item.batch >= 0)
+		{
+			queue.batches[item.batch](e);
+			current_textures = -1;
+			continue;
+		}
+		// Change textures only when needed
+		if (static_cast<int>(item.texture_set) != current_textures)
+		{
+			bind_texture_set(e, item.texture_set, queue.texture_sets[item.texture_set]);
+			current_textures = item.texture_set;
+		}
+		// Set transform uniforms
+		bind_transforms(e.transforms, transforms, item.slot);
+		// Bind material
+		renderer::bind(*item.mat, "mat");
+		// G-buffer effects store where the lighting pass finds it
+		if (e.gbuffer)
+			set_uniform(e.material_id, material_table_id(queue, item.mat));
+		// Render mesh, or the detail level chosen for it
+		if (item.geom)
+			renderer::render(*item.geom);
+		else
+			renderer::render(*item.m);
+	}
+	// Restore any state the last effect changed
+	if (current_effect >= 0 && queue.effects[current_effect].end)
+		queue.effects[current_effect].end();
+	glDepthFunc(GL_LESS);
+	glDepthMask(GL_TRUE);
+}
+
+// Issue the sorted draws with the counting effects, keeping each
+// effect's depth and culling state so the count matches what the
+// real draws would shade
+void count_queue(render_queue &queue, const transform_cache &transforms)
+{
+	auto &c = queue.counters;
+	int current_effect = -1;
+	for (auto &item : queue.items)
+	{
+		auto &e = queue.effects[item.effect_id];
+		if (static_cast<int>(item.effect_id) != current_effect)
+		{
+			current_effect = item.effect_id;
+			bool equal = is_prepass_item(queue, item);
+			// The background sits at the far plane and writes no depth
+			bool background = item.key >> 62 == PASS_BACKGROUND;
+			glDepthFunc(equal ? GL_EQUAL : background ? GL_LEQUAL : GL_LESS);
+			glDepthMask(equal || background ? GL_FALSE : GL_TRUE);
+			if (e.two_sided)
+				glDisable(GL_CULL_FACE);
+			else
+				glEnable(GL_CULL_FACE);
+			int cost = c.weighted ? e.cost : 1;
+			if (item.batch >= 0)
+			{
+				renderer::bind(c.batch_eff);
+				set_uniform(c.batch_cost, cost);
+			}
+			else
+			{
+				renderer::bind(c.mesh_eff);
+				set_uniform(c.mesh_cost, cost);
+				set_uniform(c.far_plane, background ? 1 : 0);
+			}
+		}
+		// Batches draw themselves through the counting effect
+		if (item.batch >= 0)
+		{
+			queue.batches[item.batch](e);
+			continue;
+		}
+		set_uniform(c.MVP, transforms.mvp[item.slot]);
+		if (item.geom)
+			renderer::render(*item.geom);
+		else
+			renderer::render(*item.m);
+	}
+	glDepthFunc(GL_LESS);
+	glDepthMask(GL_TRUE);
+	glEnable(GL_CULL_FACE);
+}
+
+// Sort the queue and issue every draw
+void flush_queue(render_queue &queue, const transform_cache &transforms)
+{
+	sort_queue(queue);
+	if (queue.depth_prepass)
+		draw_depth_prepass(queue, transforms);
+	draw_queue(queue, transforms);
+}
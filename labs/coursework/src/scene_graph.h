@@ -0,0 +1,80 @@
+// scene_graph.h - Header file containing the scene graph
+// Nodes are stored flattened in topological order (a parent is
+// always added before its children) with a parent index, so each
+// world matrix is a single multiply with the parent's. Only nodes
+// flagged dirty, or below a dirty node, are recomputed
+// Last modified - 18/10/2026
+
+#pragma once
+
+#include <glm\glm.hpp>
+#include <graphics_framework.h>
+#include <cassert>
+#include "transform_cache.h"
+
+using namespace std;
+using namespace graphics_framework;
+using namespace glm;
+
+// Flattened scene graph, indexed by node
+// Node indices match the transform cache slots
+struct scene_graph
+{
+	// Parent of each node, -1 for a root
+	vector<int> parent;
+	// Local transform of each node (owned by its mesh)
+	vector<transform*> local;
+	// World matrix of each node
+	vector<mat4> world;
+	// Has the local transform changed since the last update
+	vector<char> dirty;
+	// Did the world matrix change in the last update
+	vector<char> moved;
+};
+
+// Add a node under parent (-1 for a root), returns the node index
+// which is also its slot in the transform cache
+unsigned int add_node(scene_graph &graph, transform_cache &cache, transform &local, int parent = -1)
+{
+	unsigned int node = add_transform(cache);
+	// Nodes and cache slots must stay in step
+	assert(node == graph.parent.size());
+	// Parents come first so the order stays topological
+	assert(parent < static_cast<int>(node));
+	graph.parent.push_back(parent);
+	graph.local.push_back(&local);
+	graph.world.push_back(mat4(1.0f));
+	graph.dirty.push_back(1);
+	graph.moved.push_back(1);
+	return node;
+}
+
+// Flag a node whose local transform has changed
+void mark_dirty(scene_graph &graph, unsigned int node)
+{
+	graph.dirty[node] = 1;
+}
+
+// Recompute the world matrix of every dirty node and its children
+// and write them into the transform cache
+void update_scene_graph(scene_graph &graph, transform_cache &cache)
+{
+	for (size_t i = 0; i < graph.parent.size(); ++i)
+	{
+		int p = graph.parent[i];
+		// A node moves when it or anything above it moved. The parent
+		// was visited first so its flag is already up to date
+		if (p >= 0 && graph.dirty[p])
+			graph.dirty[i] = 1;
+		if (!graph.dirty[i])
+			continue;
+		// One multiply with the parent's world matrix
+		auto M = graph.local[i]->get_transform_matrix();
+		graph.world[i] = p >= 0 ? graph.world[p] * M : M;
+		cache.world[i] = graph.world[i];
+	}
+	// Remember what moved for the passes that cache their results
+	graph.moved = graph.dirty;
+	// Everything is up to date again
+	fill(graph.dirty.begin(), graph.dirty.end(), 0);
+}
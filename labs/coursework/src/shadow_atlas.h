@@ -0,0 +1,229 @@
+// shadow_atlas.h - Header file containing the shadow atlas
+// Every shadowed spot light renders into a square tile of one
+// depth texture whose size and depth format are set here rather
+// than by the window. Tiles are handed out each frame by
+// importance - how much of the screen the light's range covers
+// and how bright it is - largest first, so lights that matter get
+// sharper shadows and lights out of view get none
+// Last modified - 18/10/2026
+
+#pragma once
+
+#include <glm\glm.hpp>
+#include <graphics_framework.h>
+#include <algorithm>
+#include "uniform_blocks.h"
+
+using namespace std;
+using namespace graphics_framework;
+using namespace glm;
+
+// Default size of the atlas and bits of depth per texel (16 or 24)
+#define SHADOW_ATLAS_SIZE 2048
+#define SHADOW_ATLAS_DEPTH_BITS 24
+// Smallest tile a light is given, the atlas is packed in these
+#define SHADOW_TILE_MIN 128
+// Near and far planes of every shadow projection
+#define SHADOW_NEAR 0.1f
+#define SHADOW_FAR 1000.0f
+
+// A spot light that casts shadows
+struct shadow_light
+{
+	const spot_light *light = nullptr;
+	// Distance the light reaches
+	float range = 0.0f;
+	// Tile it was given this frame, -1 for none
+	int tile = -1;
+};
+
+// A square region of the atlas and the light it is rendered from
+struct shadow_tile
+{
+	// Light it belongs to
+	unsigned int light;
+	// Bottom left corner and size in texels
+	ivec2 origin;
+	int size;
+	// Light view and projection
+	mat4 view;
+	mat4 projection;
+	mat4 light_PV;
+	// World to atlas texture space (light_PV with the tile bias)
+	mat4 shadow_matrix;
+	// Tile in atlas texture coordinates (min xy, max xy)
+	vec4 rect;
+};
+
+// Depth texture shared by every shadowed light
+struct shadow_atlas
+{
+	GLuint buffer = 0;
+	GLuint depth = 0;
+	int size = SHADOW_ATLAS_SIZE;
+	int depth_bits = SHADOW_ATLAS_DEPTH_BITS;
+	vector<shadow_light> lights;
+	vector<shadow_tile> tiles;
+};
+
+// Create the atlas depth texture and its frame buffer
+void create_shadow_atlas(shadow_atlas &atlas, int size = SHADOW_ATLAS_SIZE, int depth_bits = SHADOW_ATLAS_DEPTH_BITS)
+{
+	atlas.size = size;
+	atlas.depth_bits = depth_bits == 16 ? 16 : 24;
+	glGenTextures(1, &atlas.depth);
+	glBindTexture(GL_TEXTURE_2D, atlas.depth);
+	glTexStorage2D(GL_TEXTURE_2D, 1, atlas.depth_bits == 16 ? GL_DEPTH_COMPONENT16 : GL_DEPTH_COMPONENT24, size, size);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glGenFramebuffers(1, &atlas.buffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, atlas.buffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, atlas.depth, 0);
+	// Depth only
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+// Let a spot light cast shadows, returns its index
+unsigned int add_shadow_light(shadow_atlas &atlas, const spot_light &light, float range)
+{
+	shadow_light l;
+	l.light = &light;
+	l.range = range;
+	atlas.lights.push_back(l);
+	return static_cast<unsigned int>(atlas.lights.size() - 1);
+}
+
+// View from a spot light down its direction
+mat4 spot_light_view(const spot_light &light)
+{
+	vec3 dir = light.get_direction();
+	// Any up that is not along the light
+	vec3 up = abs(dir.y) > 0.99f ? vec3(0.0f, 0.0f, 1.0f) : vec3(0.0f, 1.0f, 0.0f);
+	return lookAt(light.get_position(), light.get_position() + dir, up);
+}
+
+// Cell at a position along the Z order curve. Power of two tiles
+// placed along it largest first always line up with their size
+ivec2 z_order_cell(unsigned int index)
+{
+	ivec2 cell(0);
+	for (unsigned int bit = 0; bit < 16; ++bit)
+	{
+		cell.x |= ((index >> (2 * bit)) & 1) << bit;
+		cell.y |= ((index >> (2 * bit + 1)) & 1) << bit;
+	}
+	return cell;
+}
+
+// Hand out tiles to the lights the camera can see, largest to the
+// most important. pixels_per_unit is the screen height in pixels
+// covered by one unit one unit away
+void update_shadow_atlas(shadow_atlas &atlas, const vec3 &eye_pos, const array<vec4, 6> &camera_planes,
+						 float pixels_per_unit)
+{
+	// Importance and wanted size of each light
+	vector<pair<float, unsigned int>> order;
+	vector<int> wanted(atlas.lights.size(), 0);
+	for (unsigned int i = 0; i < atlas.lights.size(); ++i)
+	{
+		auto &l = *atlas.lights[i].light;
+		atlas.lights[i].tile = -1;
+		vec3 pos = l.get_position();
+		float range = atlas.lights[i].range;
+		// Lights whose reach is out of view need no shadow
+		bool in_view = true;
+		for (auto &p : camera_planes)
+			in_view = in_view && dot(vec3(p), pos) + p.w + range >= 0.0f;
+		if (!in_view)
+			continue;
+		// Pixels the light's reach covers on screen
+		float pixels = range / std::max(distance(eye_pos, pos) - range, 1.0f) * pixels_per_unit;
+		vec4 colour = l.get_light_colour();
+		float brightness = std::max(colour.r, std::max(colour.g, colour.b));
+		order.push_back(make_pair(pixels * brightness, i));
+		// Smallest power of two tile at least as big, within limits
+		int size = SHADOW_TILE_MIN;
+		while (size < pixels && size < atlas.size / 2)
+			size *= 2;
+		wanted[i] = size;
+	}
+	// Most important first, sizes never grow down the list so the
+	// Z order packing stays aligned
+	sort(order.begin(), order.end(), [](const pair<float, unsigned int> &a, const pair<float, unsigned int> &b)
+	{
+		return a.first > b.first;
+	});
+	int cap = atlas.size / 2;
+	unsigned int cells = (atlas.size / SHADOW_TILE_MIN) * (atlas.size / SHADOW_TILE_MIN);
+	unsigned int cursor = 0;
+	atlas.tiles.clear();
+	for (auto &o : order)
+	{
+		int size = std::min(wanted[o.second], cap);
+		unsigned int span = (size / SHADOW_TILE_MIN) * (size / SHADOW_TILE_MIN);
+		// Shrink the tile until it fits in what is left
+		while (cursor + span > cells && size > SHADOW_TILE_MIN)
+		{
+			size /= 2;
+			span /= 4;
+		}
+		if (cursor + span > cells)
+			break;
+		cap = size;
+		shadow_tile tile;
+		tile.light = o.second;
+		tile.origin = z_order_cell(cursor) * SHADOW_TILE_MIN;
+		tile.size = size;
+		auto &l = *atlas.lights[o.second].light;
+		tile.view = spot_light_view(l);
+		tile.projection = perspective<float>(90.f, 1.0f, SHADOW_NEAR, SHADOW_FAR);
+		tile.light_PV = tile.projection * tile.view;
+		// Clip space to this tile's texels and depth to 0..1
+		vec2 offset = vec2(tile.origin) / static_cast<float>(atlas.size);
+		float extent = static_cast<float>(size) / atlas.size;
+		mat4 bias = translate(mat4(1.0f), vec3(offset + vec2(0.5f * extent), 0.5f)) * scale(mat4(1.0f), vec3(0.5f * extent, 0.5f * extent, 0.5f));
+		tile.shadow_matrix = bias * tile.light_PV;
+		tile.rect = vec4(offset, offset + vec2(extent));
+		atlas.lights[o.second].tile = static_cast<int>(atlas.tiles.size());
+		atlas.tiles.push_back(tile);
+		cursor += span;
+	}
+}
+
+// Tile of a light, nullptr if it has none this frame
+const shadow_tile *light_tile(const shadow_atlas &atlas, const spot_light &light)
+{
+	for (auto &l : atlas.lights)
+		if (l.light == &light && l.tile >= 0)
+			return &atlas.tiles[l.tile];
+	return nullptr;
+}
+
+// Upload the atlas tiles of a set of spot lights, matching the
+// order of the lights in its light block
+void update_shadow_data(GLuint buffer, const shadow_atlas &atlas, const vector<spot_light> &spots)
+{
+	shadow_data_std140 data;
+	for (unsigned int i = 0; i < MAX_SPOT_LIGHTS; ++i)
+	{
+		auto tile = i < spots.size() ? light_tile(atlas, spots[i]) : nullptr;
+		data.shadow_matrices[i] = tile ? tile->shadow_matrix : mat4(1.0f);
+		// An empty rect means no shadow
+		data.shadow_rects[i] = tile ? tile->rect : vec4(0.0f);
+	}
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, offsetof(shadow_data_std140, cascade_matrices), &data);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+// Bind the atlas for the lit effects to sample
+void bind_shadow_atlas(const shadow_atlas &atlas)
+{
+	glActiveTexture(GL_TEXTURE0 + SHADOW_MAP_UNIT);
+	glBindTexture(GL_TEXTURE_2D, atlas.depth);
+}
@@ -0,0 +1,123 @@
+// shadow_cache.h - Header file containing the shadow map cache
+// Casters that have not moved for a while are rendered once into a
+// static depth layer the size of the shadow atlas. Each frame every
+// tile of that layer is copied into the atlas and only the casters
+// that are moving are drawn over it. The static layer is rendered
+// again when a light or the atlas layout changes, when a static
+// caster moves (it becomes dynamic again) or when a caster has been
+// still long enough to become static
+// Last modified - 18/10/2026
+
+#pragma once
+
+#include <glm\glm.hpp>
+#include <graphics_framework.h>
+#include "shadow_atlas.h"
+
+using namespace std;
+using namespace graphics_framework;
+using namespace glm;
+
+// Frames a caster must stay still before it joins the static layer
+#define SHADOW_STATIC_FRAMES 30
+
+// Layers a caster can be drawn into
+#define SHADOW_LAYER_STATIC 0
+#define SHADOW_LAYER_DYNAMIC 1
+// Every caster, for shadows rendered afresh each frame
+#define SHADOW_LAYER_ALL 2
+
+// Static depth layer and which casters are in it
+struct shadow_cache
+{
+	GLuint buffer = 0;
+	GLuint depth = 0;
+	// Frames each slot has been still for
+	vector<unsigned int> still;
+	// Is each slot drawn in the static layer
+	vector<char> is_static;
+	// Tiles the static layer was rendered for
+	vector<mat4> tile_matrices;
+	// Does the static layer need rendering again
+	bool dirty = true;
+	// Number of times the static layer has been rendered
+	unsigned int rebuilds = 0;
+};
+
+// Create the static layer with the atlas's size and format
+void load_shadow_cache(shadow_cache &cache, const shadow_atlas &atlas)
+{
+	glGenTextures(1, &cache.depth);
+	glBindTexture(GL_TEXTURE_2D, cache.depth);
+	glTexStorage2D(GL_TEXTURE_2D, 1, atlas.depth_bits == 16 ? GL_DEPTH_COMPONENT16 : GL_DEPTH_COMPONENT24, atlas.size, atlas.size);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glGenFramebuffers(1, &cache.buffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, cache.buffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, cache.depth, 0);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	cache.dirty = true;
+}
+
+// Track what moved this frame and decide if the static layer must
+// be rendered again. moved comes from the scene graph
+void update_shadow_cache(shadow_cache &cache, const vector<char> &moved, const shadow_atlas &atlas)
+{
+	if (cache.still.size() < moved.size())
+	{
+		cache.still.resize(moved.size(), 0);
+		cache.is_static.resize(moved.size(), 0);
+	}
+	// A light that moved or a tile that changed invalidates everything
+	vector<mat4> tile_matrices;
+	for (auto &t : atlas.tiles)
+		tile_matrices.push_back(t.shadow_matrix);
+	if (tile_matrices != cache.tile_matrices)
+	{
+		cache.tile_matrices = tile_matrices;
+		cache.dirty = true;
+	}
+	for (size_t slot = 0; slot < moved.size(); ++slot)
+	{
+		if (moved[slot])
+		{
+			cache.still[slot] = 0;
+			// A static caster that moves leaves the static layer
+			if (cache.is_static[slot])
+			{
+				cache.is_static[slot] = 0;
+				cache.dirty = true;
+			}
+		}
+		// A caster still for long enough joins the static layer
+		else if (++cache.still[slot] == SHADOW_STATIC_FRAMES)
+		{
+			cache.is_static[slot] = 1;
+			cache.dirty = true;
+		}
+	}
+}
+
+// Is a slot drawn into a layer
+bool in_shadow_layer(const shadow_cache &cache, unsigned int slot, int layer)
+{
+	if (layer == SHADOW_LAYER_ALL)
+		return true;
+	bool is_static = slot < cache.is_static.size() && cache.is_static[slot];
+	return layer == SHADOW_LAYER_STATIC ? is_static : !is_static;
+}
+
+// Copy a tile of the static layer's depth into the atlas
+void composite_static_layer(const shadow_cache &cache, const shadow_atlas &atlas, const shadow_tile &tile)
+{
+	GLint x0 = tile.origin.x;
+	GLint y0 = tile.origin.y;
+	GLint x1 = x0 + tile.size;
+	GLint y1 = y0 + tile.size;
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, cache.buffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, atlas.buffer);
+	glBlitFramebuffer(x0, y0, x1, y1, x0, y0, x1, y1, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+}
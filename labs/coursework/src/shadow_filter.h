@@ -0,0 +1,143 @@
+// shadow_filter.h - Header file containing the prefiltered shadows
+// Rather than one hard depth compare, the cascades can be turned
+// into variance (depth and depth squared) or exponential moments
+// that are blurred with a separable gaussian and mipmapped once
+// each time the cascades are rendered. The lit effects then read
+// them with ordinary filtered texture lookups, which gives soft
+// shadows from cascades a quarter of the size
+// Last modified - 18/10/2026
+
+#pragma once
+
+#include <glm\glm.hpp>
+#include <graphics_framework.h>
+#include "cascades.h"
+#include "uniform_blocks.h"
+#include "uniform_table.h"
+
+using namespace std;
+using namespace graphics_framework;
+using namespace glm;
+
+// Types of shadow filter (match part_shadow.frag and shadow_filter.comp)
+#define SHADOW_FILTER_HARD 0
+#define SHADOW_FILTER_VSM 1
+#define SHADOW_FILTER_ESM 2
+// Cascade size when filtered, half as wide so a quarter the texels
+#define CASCADE_FILTERED_SIZE (CASCADE_SIZE / 2)
+// Sharpness of the exponential moments, kept small enough for floats
+#define SHADOW_ESM_EXPONENT 80.0f
+
+// Blurred and mipmapped moments of every cascade
+struct shadow_filter
+{
+	int mode = SHADOW_FILTER_VSM;
+	float exponent = SHADOW_ESM_EXPONENT;
+	// Moments with their mip chain, and the half blurred moments
+	GLuint moments = 0;
+	GLuint blurred = 0;
+	int size = 0;
+	unsigned int layers = 0;
+};
+
+// Handles to the uniforms of the filter effect
+struct shadow_filter_uniforms
+{
+	uniform_handle<int> pass;
+	uniform_handle<int> filter_mode;
+	uniform_handle<float> filter_exponent;
+	uniform_handle<float> light_near;
+	uniform_handle<float> light_far;
+};
+
+// Resolve the uniforms of the filter effect
+shadow_filter_uniforms get_shadow_filter_uniforms(const uniform_table &table)
+{
+	shadow_filter_uniforms u;
+	u.pass = get_handle<int>(table, "pass");
+	u.filter_mode = get_handle<int>(table, "filter_mode");
+	u.filter_exponent = get_handle<float>(table, "filter_exponent");
+	u.light_near = get_handle<float>(table, "light_near");
+	u.light_far = get_handle<float>(table, "light_far");
+	return u;
+}
+
+// Create the moment textures for a set of cascades. A hard filter
+// needs none
+void create_shadow_filter(shadow_filter &filter, const shadow_cascades &cascades, int mode = SHADOW_FILTER_VSM)
+{
+	filter.mode = mode;
+	filter.size = cascades.size;
+	filter.layers = cascades.count;
+	if (mode == SHADOW_FILTER_HARD)
+		return;
+	// Full mip chain down to one texel
+	GLsizei levels = 1;
+	while ((filter.size >> levels) > 0)
+		++levels;
+	glGenTextures(1, &filter.moments);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, filter.moments);
+	glTexStorage3D(GL_TEXTURE_2D_ARRAY, levels, GL_RG32F, filter.size, filter.size, filter.layers);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glGenTextures(1, &filter.blurred);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, filter.blurred);
+	glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_RG32F, filter.size, filter.size, filter.layers);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+// Turn freshly rendered cascades into blurred, mipmapped moments
+void filter_shadow_cascades(const shadow_filter &filter, const shadow_cascades &cascades, effect filter_eff,
+							const shadow_filter_uniforms &u)
+{
+	if (filter.mode == SHADOW_FILTER_HARD)
+		return;
+	renderer::bind(filter_eff);
+	set_uniform(u.filter_mode, filter.mode);
+	set_uniform(u.filter_exponent, filter.exponent);
+	set_uniform(u.light_near, SHADOW_NEAR);
+	set_uniform(u.light_far, SHADOW_FAR);
+	GLuint groups = (filter.size + 15) / 16;
+	glActiveTexture(GL_TEXTURE0);
+	// Depth to moments, blurred across x
+	set_uniform(u.pass, 0);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, cascades.depth);
+	glBindImageTexture(0, filter.blurred, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RG32F);
+	glDispatchCompute(groups, groups, filter.layers);
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+	// Blurred across y into the top level
+	set_uniform(u.pass, 1);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, filter.blurred);
+	glBindImageTexture(0, filter.moments, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RG32F);
+	glDispatchCompute(groups, groups, filter.layers);
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+	// Averages of the moments for distant and sloped receivers
+	glBindTexture(GL_TEXTURE_2D_ARRAY, filter.moments);
+	glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+// Upload the filter settings into a set of lights' shadow data
+void update_filter_data(GLuint buffer, const shadow_filter &filter)
+{
+	shadow_data_std140 data;
+	data.filter_mode = filter.mode;
+	data.filter_exponent = filter.exponent;
+	data.light_near = SHADOW_NEAR;
+	data.light_far = SHADOW_FAR;
+	GLintptr offset = offsetof(shadow_data_std140, filter_mode);
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, offset, sizeof(data) - offset, reinterpret_cast<const char *>(&data) + offset);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+// Bind the moments for the lit effects to sample
+void bind_shadow_filter(const shadow_filter &filter)
+{
+	glActiveTexture(GL_TEXTURE0 + MOMENTS_MAP_UNIT);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, filter.moments);
+}
@@ -0,0 +1,517 @@
+// software_occlusion.h - Header file containing the CPU occlusion culling
+// A small masked depth buffer on the CPU. The screen is split into
+// 32x8 pixel tiles, each holding a coverage bit per pixel and two
+// depths: the farthest depth of the whole tile and the farthest
+// depth of the pixels covered since that was last raised. The big
+// occluders are drawn into it as low-poly shapes that sit inside
+// the real meshes, so nothing is hidden that the GPU would show.
+// The terrain is an open surface rather than a solid, so it stands
+// in as a coarse heightfield below it, seen from above only.
+// Bounding spheres are then tested against it before any draw is
+// submitted. Eight rows of a tile are rasterised at once with AVX2
+// where the compiler provides it, with a scalar path otherwise.
+// Only glm is used here so it runs without a GL context
+// Last modified - 18/10/2026
+
+#pragma once
+
+#include <glm\glm.hpp>
+#include <glm\gtc\constants.hpp>
+#include <glm\gtc\matrix_transform.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Rasterise eight rows at once if the compiler allows (the
+// COURSEWORK_AVX2 build option)
+#if defined(__AVX2__)
+#define SOFTWARE_OCCLUSION_AVX2
+#include <immintrin.h>
+#endif
+
+using namespace std;
+using namespace glm;
+
+// Size of the depth buffer, whole tiles across and down
+#define OCCLUSION_WIDTH 256
+#define OCCLUSION_HEIGHT 128
+#define OCCLUSION_TILE_WIDTH 32
+#define OCCLUSION_TILE_HEIGHT 8
+#define OCCLUSION_TILES_X (OCCLUSION_WIDTH / OCCLUSION_TILE_WIDTH)
+#define OCCLUSION_TILES_Y (OCCLUSION_HEIGHT / OCCLUSION_TILE_HEIGHT)
+
+// Occluder shapes, each inside the box it is fitted to
+#define OCCLUDER_SPHERE 0
+#define OCCLUDER_TUBE 1
+#define OCCLUDER_BOX 2
+#define OCCLUDER_SHAPES 3
+// A heightfield with triangles of its own, see
+// create_heightfield_occluder
+#define OCCLUDER_HEIGHTFIELD 3
+// Segments around the low-poly sphere and tube
+#define OCCLUDER_SEGMENTS 12
+
+// One tile of the masked depth buffer
+struct occlusion_tile
+{
+	// Pixels covered since zmax0 was last raised, a row per entry
+	// and a bit per column
+	uint32_t mask[OCCLUSION_TILE_HEIGHT];
+	// Farthest depth of the whole tile
+	float zmax0;
+	// Farthest depth of the covered pixels
+	float zmax1;
+};
+
+// A mesh standing in as an occluder
+struct occluder
+{
+	int shape;
+	// Transform slot of the mesh
+	unsigned int slot;
+	// Object space box the shape is fitted to
+	vec3 min_point;
+	vec3 max_point;
+	// Object space triangles of a heightfield, anticlockwise seen
+	// from the side they hide
+	vector<vec3> triangles;
+};
+
+// The depth buffer and the shapes it draws
+struct software_occlusion
+{
+	vector<occlusion_tile> tiles;
+	// Camera of the frame
+	mat4 PV;
+	// Object space triangles of each shape, fitted to a -1..1 box
+	array<vector<vec3>, OCCLUDER_SHAPES> shapes;
+	// Triangles drawn and objects hidden this frame
+	unsigned int triangles = 0;
+	unsigned int occluded = 0;
+};
+
+// Build the low-poly shapes. The vertices lie on the surfaces of
+// the unit sphere and tube, so the faces are inside them
+void create_software_occlusion(software_occlusion &sw)
+{
+	sw.tiles.resize(OCCLUSION_TILES_X * OCCLUSION_TILES_Y);
+	const int segments = OCCLUDER_SEGMENTS;
+	const int stacks = OCCLUDER_SEGMENTS / 2;
+	// Sphere
+	auto &sphere = sw.shapes[OCCLUDER_SPHERE];
+	auto sphere_point = [&](int stack, int segment)
+	{
+		float theta = pi<float>() * stack / stacks;
+		float phi = two_pi<float>() * segment / segments;
+		return vec3(sin(theta) * cos(phi), cos(theta), sin(theta) * sin(phi));
+	};
+	for (int i = 0; i < stacks; ++i)
+	{
+		for (int j = 0; j < segments; ++j)
+		{
+			vec3 a = sphere_point(i, j), b = sphere_point(i + 1, j);
+			vec3 c = sphere_point(i + 1, j + 1), d = sphere_point(i, j + 1);
+			sphere.insert(sphere.end(), { a, b, c, a, c, d });
+		}
+	}
+	// Tube - the walls of a cylinder along y, open at both ends
+	auto &tube = sw.shapes[OCCLUDER_TUBE];
+	for (int j = 0; j < segments; ++j)
+	{
+		float phi0 = two_pi<float>() * j / segments;
+		float phi1 = two_pi<float>() * (j + 1) / segments;
+		vec3 a(cos(phi0), -1.0f, sin(phi0)), b(cos(phi1), -1.0f, sin(phi1));
+		vec3 c(cos(phi1), 1.0f, sin(phi1)), d(cos(phi0), 1.0f, sin(phi0));
+		tube.insert(tube.end(), { a, b, c, a, c, d });
+	}
+	// Box
+	auto &box = sw.shapes[OCCLUDER_BOX];
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		for (float side = -1.0f; side <= 1.0f; side += 2.0f)
+		{
+			vec3 n(0.0f), u(0.0f), v(0.0f);
+			n[axis] = side;
+			u[(axis + 1) % 3] = 1.0f;
+			v[(axis + 2) % 3] = 1.0f;
+			vec3 a = n - u - v, b = n + u - v, c = n + u + v, d = n - u + v;
+			box.insert(box.end(), { a, b, c, a, c, d });
+		}
+	}
+}
+
+// Empty the depth buffer for a new frame's camera
+void clear_software_occlusion(software_occlusion &sw, const mat4 &PV)
+{
+	for (auto &t : sw.tiles)
+	{
+		for (auto &m : t.mask)
+			m = 0;
+		t.zmax0 = 1.0f;
+		t.zmax1 = 0.0f;
+	}
+	sw.PV = PV;
+	sw.triangles = 0;
+	sw.occluded = 0;
+}
+
+// Coverage of a tile's eight rows by a triangle's three edges, a
+// row at a time. Each edge is inside where a * x + b * y + c >= 0,
+// x and y being pixel centres relative to the tile's corner
+void tile_coverage_scalar(const vec3 edges[3], uint32_t rows[OCCLUSION_TILE_HEIGHT])
+{
+	for (int r = 0; r < OCCLUSION_TILE_HEIGHT; ++r)
+	{
+		uint32_t covered = 0xFFFFFFFFu;
+		for (int e = 0; e < 3; ++e)
+		{
+			float a = edges[e].x;
+			// Summed in the same order as the AVX2 path
+			float value = edges[e].y * (r + 0.5f) + (edges[e].z + a * 0.5f);
+			uint32_t bits;
+			if (a == 0.0f)
+				bits = value >= 0.0f ? 0xFFFFFFFFu : 0u;
+			else
+			{
+				float cross = value / -a;
+				if (a > 0.0f)
+				{
+					int start = static_cast<int>(glm::clamp(ceil(cross), 0.0f, 32.0f));
+					bits = start >= 32 ? 0u : 0xFFFFFFFFu << start;
+				}
+				else
+				{
+					int count = static_cast<int>(glm::clamp(floor(cross) + 1.0f, 0.0f, 32.0f));
+					bits = count == 0 ? 0u : 0xFFFFFFFFu >> (32 - count);
+				}
+			}
+			covered &= bits;
+		}
+		rows[r] = covered;
+	}
+}
+
+#if defined(SOFTWARE_OCCLUSION_AVX2)
+// The same coverage with all eight rows in one AVX2 register. The
+// steps match the scalar path so the bits come out identical
+void tile_coverage_avx2(const vec3 edges[3], uint32_t rows[OCCLUSION_TILE_HEIGHT])
+{
+	__m256 y = _mm256_set_ps(7.5f, 6.5f, 5.5f, 4.5f, 3.5f, 2.5f, 1.5f, 0.5f);
+	__m256i ones = _mm256_set1_epi32(-1);
+	__m256i covered = ones;
+	for (int e = 0; e < 3; ++e)
+	{
+		float a = edges[e].x;
+		// Value at the first column's centre of each row
+		__m256 value = _mm256_add_ps(_mm256_mul_ps(y, _mm256_set1_ps(edges[e].y)), _mm256_set1_ps(edges[e].z + a * 0.5f));
+		__m256i bits;
+		if (a == 0.0f)
+			bits = _mm256_castps_si256(_mm256_cmp_ps(value, _mm256_setzero_ps(), _CMP_GE_OQ));
+		else
+		{
+			// Column where the edge crosses each row
+			__m256 cross = _mm256_div_ps(value, _mm256_set1_ps(-a));
+			__m256 limit = _mm256_set1_ps(static_cast<float>(OCCLUSION_TILE_WIDTH));
+			if (a > 0.0f)
+			{
+				// Columns from the crossing on
+				__m256i start = _mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(_mm256_ceil_ps(cross), _mm256_setzero_ps()), limit));
+				bits = _mm256_sllv_epi32(ones, start);
+			}
+			else
+			{
+				// Columns up to the crossing
+				__m256 end = _mm256_add_ps(_mm256_floor_ps(cross), _mm256_set1_ps(1.0f));
+				__m256i count = _mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(end, _mm256_setzero_ps()), limit));
+				bits = _mm256_srlv_epi32(ones, _mm256_sub_epi32(_mm256_set1_epi32(OCCLUSION_TILE_WIDTH), count));
+			}
+		}
+		covered = _mm256_and_si256(covered, bits);
+	}
+	_mm256_storeu_si256(reinterpret_cast<__m256i *>(rows), covered);
+}
+#endif
+
+// Coverage of a tile by the fastest path built in
+void tile_coverage(const vec3 edges[3], uint32_t rows[OCCLUSION_TILE_HEIGHT])
+{
+#if defined(SOFTWARE_OCCLUSION_AVX2)
+	tile_coverage_avx2(edges, rows);
+#else
+	tile_coverage_scalar(edges, rows);
+#endif
+}
+
+// Merge a triangle's coverage at a depth into a tile
+void update_tile(occlusion_tile &tile, const uint32_t coverage[OCCLUSION_TILE_HEIGHT], float z)
+{
+	// Behind everything already there
+	if (z >= tile.zmax0)
+		return;
+	bool empty = true;
+	bool full = true;
+	for (int r = 0; r < OCCLUSION_TILE_HEIGHT; ++r)
+		empty = empty && tile.mask[r] == 0;
+	// A covered layer much nearer the back than the triangle is
+	// dropped rather than dragging the triangle's depth back to it
+	if (!empty && tile.zmax1 - z > tile.zmax0 - tile.zmax1)
+	{
+		for (auto &m : tile.mask)
+			m = 0;
+		empty = true;
+	}
+	tile.zmax1 = empty ? z : std::max(tile.zmax1, z);
+	for (int r = 0; r < OCCLUSION_TILE_HEIGHT; ++r)
+	{
+		tile.mask[r] |= coverage[r];
+		full = full && tile.mask[r] == 0xFFFFFFFFu;
+	}
+	// Once the tile is covered its depth moves forward
+	if (full)
+	{
+		tile.zmax0 = tile.zmax1;
+		tile.zmax1 = 0.0f;
+		for (auto &m : tile.mask)
+			m = 0;
+	}
+}
+
+// Rasterise a triangle given in screen pixels and depth. One sided
+// triangles facing away are skipped
+void rasterise_triangle(software_occlusion &sw, vec3 v0, vec3 v1, vec3 v2, bool one_sided = false)
+{
+	float area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+	if (abs(area) < 1e-6f)
+		return;
+	// Otherwise either winding occludes, make it anticlockwise
+	if (area < 0.0f)
+	{
+		if (one_sided)
+			return;
+		std::swap(v1, v2);
+		area = -area;
+	}
+	// Pixels the triangle may touch
+	int min_x = std::max(0, static_cast<int>(floor(std::min(v0.x, std::min(v1.x, v2.x)))));
+	int max_x = std::min(OCCLUSION_WIDTH - 1, static_cast<int>(ceil(std::max(v0.x, std::max(v1.x, v2.x)))));
+	int min_y = std::max(0, static_cast<int>(floor(std::min(v0.y, std::min(v1.y, v2.y)))));
+	int max_y = std::min(OCCLUSION_HEIGHT - 1, static_cast<int>(ceil(std::max(v0.y, std::max(v1.y, v2.y)))));
+	if (min_x > max_x || min_y > max_y)
+		return;
+	++sw.triangles;
+	// Depth plane
+	float dzdx = ((v1.z - v0.z) * (v2.y - v0.y) - (v2.z - v0.z) * (v1.y - v0.y)) / area;
+	float dzdy = ((v2.z - v0.z) * (v1.x - v0.x) - (v1.z - v0.z) * (v2.x - v0.x)) / area;
+	float z_far = std::max(v0.z, std::max(v1.z, v2.z));
+	const vec3 *v[3] = { &v0, &v1, &v2 };
+	for (int ty = min_y / OCCLUSION_TILE_HEIGHT; ty <= max_y / OCCLUSION_TILE_HEIGHT; ++ty)
+	{
+		for (int tx = min_x / OCCLUSION_TILE_WIDTH; tx <= max_x / OCCLUSION_TILE_WIDTH; ++tx)
+		{
+			float ox = static_cast<float>(tx * OCCLUSION_TILE_WIDTH);
+			float oy = static_cast<float>(ty * OCCLUSION_TILE_HEIGHT);
+			// Edges relative to the tile's corner, inside on the left
+			vec3 edges[3];
+			for (int e = 0; e < 3; ++e)
+			{
+				const vec3 &p = *v[e];
+				const vec3 &q = *v[(e + 1) % 3];
+				float a = -(q.y - p.y);
+				float b = q.x - p.x;
+				edges[e] = vec3(a, b, -(a * (p.x - ox) + b * (p.y - oy)));
+			}
+			uint32_t coverage[OCCLUSION_TILE_HEIGHT];
+			tile_coverage(edges, coverage);
+			bool any = false;
+			for (auto c : coverage)
+				any = any || c != 0;
+			if (!any)
+				continue;
+			// Farthest the plane gets over the tile, and no farther
+			// than the triangle's farthest vertex
+			float z = v0.z + dzdx * (ox - v0.x) + dzdy * (oy - v0.y);
+			z += std::max(dzdx * OCCLUSION_TILE_WIDTH, 0.0f) + std::max(dzdy * OCCLUSION_TILE_HEIGHT, 0.0f);
+			z = glm::clamp(std::min(z, z_far), 0.0f, 1.0f);
+			update_tile(sw.tiles[ty * OCCLUSION_TILES_X + tx], coverage, z);
+		}
+	}
+}
+
+// Matrix placing a shape over an occluder's box in world space
+mat4 occluder_matrix(const occluder &o, const mat4 &world, float shrink = 1.0f)
+{
+	vec3 centre = (o.min_point + o.max_point) * 0.5f;
+	vec3 half_size = (o.max_point - o.min_point) * 0.5f * shrink;
+	return world * translate(mat4(1.0f), centre) * scale(mat4(1.0f), half_size);
+}
+
+// Build a heightfield occluder from the vertices of a terrain lying
+// along x and z. Each of the cells_x by cells_z cells is flat at the
+// lowest vertex in it and its neighbours, so any triangle reaching
+// into it from next door is above it too, as long as the cells are
+// wider than the triangles. Steps between cells get a wall facing
+// the lower cell, which is still under the terrain. There are no
+// sides or bottom, as the terrain has none
+occluder create_heightfield_occluder(unsigned int slot, const vector<vec3> &positions, int cells_x, int cells_z)
+{
+	occluder o = { OCCLUDER_HEIGHTFIELD, slot, vec3(0.0f), vec3(0.0f) };
+	if (positions.empty())
+		return o;
+	o.min_point = positions[0];
+	o.max_point = positions[0];
+	for (auto &p : positions)
+	{
+		o.min_point = glm::min(o.min_point, p);
+		o.max_point = glm::max(o.max_point, p);
+	}
+	vec3 size = glm::max(o.max_point - o.min_point, vec3(1e-6f));
+	auto cell_of = [&](const vec3 &p, int axis, int cells)
+	{
+		return glm::clamp(static_cast<int>((p[axis] - o.min_point[axis]) / size[axis] * cells), 0, cells - 1);
+	};
+	// Lowest vertex in each cell, none marked by the float's maximum
+	const float none = numeric_limits<float>::max();
+	vector<float> lowest(cells_x * cells_z, none);
+	for (auto &p : positions)
+	{
+		float &h = lowest[cell_of(p, 2, cells_z) * cells_x + cell_of(p, 0, cells_x)];
+		h = std::min(h, p.y);
+	}
+	// Then the lowest of each cell and its neighbours, a cell with
+	// no vertices near it is left out
+	vector<float> height(lowest.size());
+	for (int z = 0; z < cells_z; ++z)
+	{
+		for (int x = 0; x < cells_x; ++x)
+		{
+			float h = none;
+			for (int nz = std::max(z - 1, 0); nz <= std::min(z + 1, cells_z - 1); ++nz)
+				for (int nx = std::max(x - 1, 0); nx <= std::min(x + 1, cells_x - 1); ++nx)
+					h = std::min(h, lowest[nz * cells_x + nx]);
+			height[z * cells_x + x] = h;
+		}
+	}
+	// A quad turned to face along facing
+	auto quad = [&](vec3 a, vec3 b, vec3 c, vec3 d, const vec3 &facing)
+	{
+		if (dot(cross(b - a, c - a), facing) < 0.0f)
+			std::swap(b, d);
+		o.triangles.insert(o.triangles.end(), { a, b, c, a, c, d });
+	};
+	vec3 cell = size / vec3(static_cast<float>(cells_x), 1.0f, static_cast<float>(cells_z));
+	for (int z = 0; z < cells_z; ++z)
+	{
+		for (int x = 0; x < cells_x; ++x)
+		{
+			float h = height[z * cells_x + x];
+			if (h == none)
+				continue;
+			float x0 = o.min_point.x + cell.x * x, x1 = x0 + cell.x;
+			float z0 = o.min_point.z + cell.z * z, z1 = z0 + cell.z;
+			quad(vec3(x0, h, z0), vec3(x0, h, z1), vec3(x1, h, z1), vec3(x1, h, z0), vec3(0.0f, 1.0f, 0.0f));
+			// Steps up to the next cell along x and along z
+			if (x + 1 < cells_x)
+			{
+				float next = height[z * cells_x + x + 1];
+				if (next != h && next != none)
+					quad(vec3(x1, h, z0), vec3(x1, h, z1), vec3(x1, next, z1), vec3(x1, next, z0),
+						vec3(next > h ? -1.0f : 1.0f, 0.0f, 0.0f));
+			}
+			if (z + 1 < cells_z)
+			{
+				float next = height[(z + 1) * cells_x + x];
+				if (next != h && next != none)
+					quad(vec3(x0, h, z1), vec3(x1, h, z1), vec3(x1, next, z1), vec3(x0, next, z1),
+						vec3(0.0f, 0.0f, next > h ? -1.0f : 1.0f));
+			}
+		}
+	}
+	return o;
+}
+
+// Draw an occluder's shape with its world matrix. A heightfield is
+// drawn as it is, the other shapes are fitted to the box
+void render_occluder(software_occlusion &sw, const occluder &o, const mat4 &world, float shrink = 1.0f)
+{
+	bool heightfield = o.shape == OCCLUDER_HEIGHTFIELD;
+	mat4 MVP = sw.PV * (heightfield ? world : occluder_matrix(o, world, shrink));
+	auto &tris = heightfield ? o.triangles : sw.shapes[o.shape];
+	for (size_t i = 0; i + 2 < tris.size(); i += 3)
+	{
+		vec3 screen[3];
+		bool clipped = false;
+		for (int k = 0; k < 3 && !clipped; ++k)
+		{
+			vec4 clip = MVP * vec4(tris[i + k], 1.0f);
+			// Triangles through the near plane are left out - an
+			// occluder drawing less only hides less
+			if (clip.w <= 0.0f || clip.z < -clip.w)
+			{
+				clipped = true;
+				break;
+			}
+			vec3 ndc = vec3(clip) / clip.w;
+			screen[k] = vec3((ndc.x * 0.5f + 0.5f) * OCCLUSION_WIDTH, (ndc.y * 0.5f + 0.5f) * OCCLUSION_HEIGHT,
+				std::min(ndc.z * 0.5f + 0.5f, 1.0f));
+		}
+		if (!clipped)
+			rasterise_triangle(sw, screen[0], screen[1], screen[2], heightfield);
+	}
+}
+
+// Could any of a world space sphere be in front of the occluders
+bool test_occlusion_sphere(const software_occlusion &sw, const vec3 &centre, float radius)
+{
+	// Screen box and nearest depth from the corners of the sphere's box
+	vec3 box_min(numeric_limits<float>::max());
+	vec3 box_max(-numeric_limits<float>::max());
+	for (int c = 0; c < 8; ++c)
+	{
+		vec3 corner = centre + radius * vec3(c & 1 ? 1.0f : -1.0f, c & 2 ? 1.0f : -1.0f, c & 4 ? 1.0f : -1.0f);
+		vec4 clip = sw.PV * vec4(corner, 1.0f);
+		// Reaching behind the camera - cannot be tested
+		if (clip.w <= 0.0f)
+			return true;
+		vec3 ndc = vec3(clip) / clip.w;
+		box_min = glm::min(box_min, ndc);
+		box_max = glm::max(box_max, ndc);
+	}
+	float nearest = box_min.z * 0.5f + 0.5f;
+	if (nearest <= 0.0f)
+		return true;
+	int min_x = std::max(0, static_cast<int>(floor((box_min.x * 0.5f + 0.5f) * OCCLUSION_WIDTH)));
+	int max_x = std::min(OCCLUSION_WIDTH - 1, static_cast<int>(floor((box_max.x * 0.5f + 0.5f) * OCCLUSION_WIDTH)));
+	int min_y = std::max(0, static_cast<int>(floor((box_min.y * 0.5f + 0.5f) * OCCLUSION_HEIGHT)));
+	int max_y = std::min(OCCLUSION_HEIGHT - 1, static_cast<int>(floor((box_max.y * 0.5f + 0.5f) * OCCLUSION_HEIGHT)));
+	// Off screen, the frustum cull decides
+	if (min_x > max_x || min_y > max_y)
+		return true;
+	for (int ty = min_y / OCCLUSION_TILE_HEIGHT; ty <= max_y / OCCLUSION_TILE_HEIGHT; ++ty)
+	{
+		for (int tx = min_x / OCCLUSION_TILE_WIDTH; tx <= max_x / OCCLUSION_TILE_WIDTH; ++tx)
+		{
+			auto &tile = sw.tiles[ty * OCCLUSION_TILES_X + tx];
+			// In front of every pixel of the tile
+			if (nearest <= tile.zmax1)
+				return true;
+			if (nearest > tile.zmax0)
+				continue;
+			// In front of the pixels not yet covered - any of them
+			// under the box means it may show
+			int x0 = std::max(min_x - tx * OCCLUSION_TILE_WIDTH, 0);
+			int x1 = std::min(max_x - tx * OCCLUSION_TILE_WIDTH, OCCLUSION_TILE_WIDTH - 1);
+			uint32_t columns = (0xFFFFFFFFu >> (31 - (x1 - x0))) << x0;
+			int y0 = std::max(min_y - ty * OCCLUSION_TILE_HEIGHT, 0);
+			int y1 = std::min(max_y - ty * OCCLUSION_TILE_HEIGHT, OCCLUSION_TILE_HEIGHT - 1);
+			for (int r = y0; r <= y1; ++r)
+			{
+				if (columns & ~tile.mask[r])
+					return true;
+			}
+		}
+	}
+	return false;
+}
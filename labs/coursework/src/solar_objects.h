@@ -3,12 +3,13 @@
 // Functions to load the objects, load the shadow plane,
 // make the planets orbit the sun, shrink the sun and form
 // a black hole
-// Last modified - 20/04/2017
+// Last modified - 18/10/2026
 
 #pragma once
 
 #include <glm\glm.hpp>
 #include <graphics_framework.h>
+#include "geometry_cache.h"
 
 using namespace std;
 using namespace graphics_framework;
@@ -156,29 +157,22 @@ void generate_terrain(geometry &geom, const texture &height_map, unsigned int wi
 }
 
 // Load all solar objects
-void load_solar_objects(map<string, mesh> &solar_objects, geometry &distortion, map<string, 
+void load_solar_objects(map<string, mesh> &solar_objects, map<string, 
 	texture> &textures, array<texture, 14> &jupiter_texs, map<string, texture> &normal_maps, 
 	map<string, float> &orbit_factors, 
-	map<string, effect> &effects) 
+	map<string, effect> &effects, geometry_cache &geometries) 
 {
-	// BLACK HOLE DISTORTION
-	vector<vec3> distortion_position;
-	distortion_position.push_back(vec3(0.0f, 0.0f, 0.0f));
-	// Create geometry using these points
-	distortion.add_buffer(distortion_position, BUFFER_INDEXES::POSITION_BUFFER);
-	// Set geometry type to points
-	distortion.set_type(GL_POINTS);
-
 	// SOLAR OBJECT MESHES 
-	solar_objects["sun"] = mesh(geometry(geometry_builder::create_sphere(100, 100)));
-	solar_objects["mercury"] = mesh(geometry(geometry_builder::create_sphere(100, 100)));
-	solar_objects["venus"] = mesh(geometry(geometry_builder::create_sphere(100, 100)));
-	solar_objects["earth"] = mesh(geometry(geometry_builder::create_sphere(100, 100)));
-	solar_objects["mars"] = mesh(geometry(geometry_builder::create_sphere(100, 100)));
-	solar_objects["jupiter"] = mesh(geometry(geometry_builder::create_sphere(100, 100)));
-	solar_objects["clouds"] = mesh(geometry(geometry_builder::create_sphere(100, 100)));
-	solar_objects["black_hole"] = mesh(geometry(geometry_builder::create_sphere(100, 100)));
-	solar_objects["comet"] = mesh(geometry("models/Asteroid.obj"));
+	// Every body shares one sphere, only the transforms differ
+	solar_objects["sun"] = mesh(cached_sphere(geometries, 100, 100));
+	solar_objects["mercury"] = mesh(cached_sphere(geometries, 100, 100));
+	solar_objects["venus"] = mesh(cached_sphere(geometries, 100, 100));
+	solar_objects["earth"] = mesh(cached_sphere(geometries, 100, 100));
+	solar_objects["mars"] = mesh(cached_sphere(geometries, 100, 100));
+	solar_objects["jupiter"] = mesh(cached_sphere(geometries, 100, 100));
+	solar_objects["clouds"] = mesh(cached_sphere(geometries, 100, 100));
+	solar_objects["black_hole"] = mesh(cached_sphere(geometries, 100, 100));
+	solar_objects["comet"] = mesh(cached_model(geometries, "models/Asteroid.obj"));
 	
 	// TRANSFORM MESHES
 	solar_objects["earth"].get_transform().translate(vec3(20.0f, 0.0f, -40.0f));
@@ -208,9 +202,9 @@ void load_solar_objects(map<string, mesh> &solar_objects, geometry &distortion,
 	solar_objects["jupiter"].get_transform().translate(5.2f * earth_position);
 	solar_objects["jupiter"].get_transform().rotate(vec3(-half_pi<float>(), 0.0f, 0.0f));
 
-	solar_objects["clouds"].get_transform().scale = vec3(1.01f) * earth_scale;
-	solar_objects["clouds"].get_transform().position = earth_position;
-	solar_objects["clouds"].get_transform().rotate(vec3(-half_pi<float>(), 0.0f, 0.0f));
+	// Clouds are a child of Earth in the scene graph, so their
+	// transform is relative to it
+	solar_objects["clouds"].get_transform().scale = vec3(1.01f);
 
 	solar_objects["comet"].get_transform().position = vec3(-50.0f, 0.0f, 50.0f);
 	solar_objects["comet"].get_transform().scale = vec3(0.1f);
@@ -243,7 +237,6 @@ void load_solar_objects(map<string, mesh> &solar_objects, geometry &distortion,
 	orbit_factors["mercury"] = 1.5f;
 	orbit_factors["venus"] = 1.1f;
 	orbit_factors["earth"] = 0.0f;
-	orbit_factors["clouds"] = 0.0f;
 	orbit_factors["mars"] = -0.235f;
 	orbit_factors["jupiter"] = -0.4f;
 	
@@ -286,31 +279,31 @@ void load_solar_objects(map<string, mesh> &solar_objects, geometry &distortion,
 	// SHADERS
 	// Load in shaders for planets
 	effects["planet_eff"].add_shader("shaders/planet_shader.vert", GL_VERTEX_SHADER);
-	vector<string> planet_eff_frag_shaders{ "shaders/simple_texture.frag", "shaders/part_point.frag", "shaders/part_shadow.frag", "shaders/part_normal_map.frag", "shaders/part_spot.frag", "shaders/part_fog.frag" };
+	vector<string> planet_eff_frag_shaders{ "shaders/simple_texture.frag", "shaders/part_point.frag", "shaders/part_shadow.frag", "shaders/part_cluster.frag", "shaders/part_normal_map.frag", "shaders/part_spot.frag", "shaders/part_fog.frag" };
 	effects["planet_eff"].add_shader(planet_eff_frag_shaders, GL_FRAGMENT_SHADER);
 	effects["planet_eff"].build();
 
+	// Load in shaders for planets drawn together in one instanced draw
+	effects["planet_instanced_eff"].add_shader("shaders/planet_instanced.vert", GL_VERTEX_SHADER);
+	vector<string> planet_instanced_eff_frag_shaders{ "shaders/planet_instanced.frag", "shaders/part_point.frag", "shaders/part_shadow.frag", "shaders/part_cluster.frag", "shaders/part_spot.frag" };
+	effects["planet_instanced_eff"].add_shader(planet_instanced_eff_frag_shaders, GL_FRAGMENT_SHADER);
+	effects["planet_instanced_eff"].build();
+
 	// Load in shaders for clouds
 	effects["cloud_eff"].add_shader("shaders/planet_shader.vert", GL_VERTEX_SHADER);
-	vector<string> cloud_eff_frag_shaders{ "shaders/cloud_texture.frag", "shaders/part_spot.frag", "shaders/part_point.frag", "shaders/part_shadow.frag", "shaders/part_normal_map.frag", "shaders/part_fog.frag" };
+	vector<string> cloud_eff_frag_shaders{ "shaders/cloud_texture.frag", "shaders/part_spot.frag", "shaders/part_point.frag", "shaders/part_shadow.frag", "shaders/part_cluster.frag", "shaders/part_normal_map.frag", "shaders/part_fog.frag" };
 	effects["cloud_eff"].add_shader(cloud_eff_frag_shaders, GL_FRAGMENT_SHADER);
 	effects["cloud_eff"].build();
 
 	// Load in shaders for sun
-	effects["sun_eff"].add_shader("shaders/sun_shader.vert", GL_VERTEX_SHADER);
+	// The surface is pushed out in the vertex shader
+	effects["sun_eff"].add_shader("shaders/dynamic_sun.vert", GL_VERTEX_SHADER);
 	effects["sun_eff"].add_shader(planet_eff_frag_shaders, GL_FRAGMENT_SHADER);
-	effects["sun_eff"].add_shader("shaders/dynamic_sun.geom", GL_GEOMETRY_SHADER);
 	effects["sun_eff"].build();
 
-	// Load in distortion shaders
-	effects["distortion_eff"].add_shader("shaders/shader.vert", GL_VERTEX_SHADER);
-	effects["distortion_eff"].add_shader("shaders/billboard_env.geom", GL_GEOMETRY_SHADER);
-	effects["distortion_eff"].add_shader("shaders/shader.frag", GL_FRAGMENT_SHADER);
-	effects["distortion_eff"].build();
-
 	// Load in shaders for weather changes
 	effects["weather_eff"].add_shader("shaders/weather.vert", GL_VERTEX_SHADER);
-	vector<string> weather_eff_frag_shaders{ "shaders/weather.frag", "shaders/part_spot.frag", "shaders/part_point.frag", "shaders/part_shadow.frag" };
+	vector<string> weather_eff_frag_shaders{ "shaders/weather.frag", "shaders/part_spot.frag", "shaders/part_point.frag", "shaders/part_shadow.frag", "shaders/part_cluster.frag" };
 	effects["weather_eff"].add_shader(weather_eff_frag_shaders, GL_FRAGMENT_SHADER);
 	effects["weather_eff"].build();
 }
@@ -345,7 +338,7 @@ void load_terrain(mesh &terrain, mesh &cube, array<texture, 4> &terrain_texs, ma
 
 	// SHADER
 	effects["terrain_eff"].add_shader("shaders/terrain.vert", GL_VERTEX_SHADER);
-	vector<string> terrain_eff_frag_shaders{ "shaders/terrain.frag", "shaders/part_spot.frag", "shaders/part_point.frag", "shaders/part_weighted_texture_4.frag", "shaders/part_fog.frag", "shaders/part_shadow.frag" };
+	vector<string> terrain_eff_frag_shaders{ "shaders/terrain.frag", "shaders/part_spot.frag", "shaders/part_point.frag", "shaders/part_weighted_texture_4.frag", "shaders/part_fog.frag", "shaders/part_shadow.frag", "shaders/part_cluster.frag" };
 	effects["terrain_eff"].add_shader(terrain_eff_frag_shaders, GL_FRAGMENT_SHADER);
 	effects["terrain_eff"].build();
 }
@@ -451,11 +444,10 @@ void system_motion(map<string, mesh> &solar_objects, map<string, float> orbit_fa
 		{
 			asteroid_motion(m, sun, orbit_factors[e.first], destroy_solar_system, delta_time);
 		}
-		// The clouds rotate faster than the Earth
+		// The clouds follow Earth and rotate faster than it
 		else if (e.first == "clouds")
 		{
 			m.get_transform().rotate(vec3(0.0f, 0.0f, 2.0f * delta_time));
-			orbit(m, sun, orbit_factors[e.first], destroy_solar_system, delta_time);
 		}
 		// All else simply orbit the sun
 		else
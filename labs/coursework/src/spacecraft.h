@@ -2,35 +2,38 @@
 // Functions to load the Enterprise and Rama and control their
 // motion
 // Generate terrain creates terrain for use inside Rama
-// Last modified - 20/04/2017
+// Rama's interior is only drawn when it can be seen
+// Last modified - 18/10/2026
 
 #pragma once
 
 #include <glm\glm.hpp>
 #include <graphics_framework.h>
+#include "geometry_cache.h"
 
 using namespace std;
 using namespace graphics_framework;
 using namespace glm;
 
 // Load the Enterprise
-void load_enterprise(array<mesh, 7> &enterprise, array<mesh, 2> &motions, map<string, texture> &textures, array<texture, 2> &motions_textures, map<string, texture> &normal_maps, map<string, effect> &effects)
+void load_enterprise(array<mesh, 7> &enterprise, array<mesh, 2> &motions, map<string, texture> &textures, array<texture, 2> &motions_textures, map<string, texture> &normal_maps, map<string, effect> &effects, geometry_cache &geometries)
 {
 	// ENTERPRISE MESHES
+	// Matching parts share their geometry through the cache
 	// Saucer section
-	enterprise[0] = mesh(geometry_builder::create_cylinder(100, 100));
+	enterprise[0] = mesh(cached_cylinder(geometries, 100, 100));
 	// Connection
-	enterprise[1] = mesh(geometry_builder::create_box(vec3(1.0f, 4.0f, 1.0f)));
+	enterprise[1] = mesh(cached_box(geometries, vec3(1.0f, 4.0f, 1.0f)));
 	// Shaft?
-	enterprise[2] = mesh(geometry_builder::create_cylinder(20, 20, vec3(1.5f, 8.0f, 1.5f)));
+	enterprise[2] = mesh(cached_cylinder(geometries, 20, 20, vec3(1.5f, 8.0f, 1.5f)));
 	// Nacelles
-	enterprise[3] = mesh(geometry_builder::create_cylinder(20, 20, vec3(1.0f, 10.0, 1.0f)));
-	enterprise[4] = mesh(geometry_builder::create_cylinder(20, 20, vec3(1.0f, 10.0, 1.0f)));
-	enterprise[5] = mesh(geometry_builder::create_box(vec3(0.1f, 5.0f, 1.0f)));
-	enterprise[6] = mesh(geometry_builder::create_box(vec3(0.1f, 5.0f, 1.0f)));
+	enterprise[3] = mesh(cached_cylinder(geometries, 20, 20, vec3(1.0f, 10.0, 1.0f)));
+	enterprise[4] = mesh(cached_cylinder(geometries, 20, 20, vec3(1.0f, 10.0, 1.0f)));
+	enterprise[5] = mesh(cached_box(geometries, vec3(0.1f, 5.0f, 1.0f)));
+	enterprise[6] = mesh(cached_box(geometries, vec3(0.1f, 5.0f, 1.0f)));
 	// Nacelle light domes
-	motions[0] = mesh(geometry_builder::create_sphere(20, 20, vec3(0.5f)));
-	motions[1] = mesh(geometry_builder::create_sphere(20, 20, vec3(0.5f)));
+	motions[0] = mesh(cached_sphere(geometries, 20, 20, vec3(0.5f)));
+	motions[1] = mesh(cached_sphere(geometries, 20, 20, vec3(0.5f)));
 
 	// TRANSFORM MESHES
 	// Enterprise (transform hierarchy in place)
@@ -52,9 +55,9 @@ void load_enterprise(array<mesh, 7> &enterprise, array<mesh, 2> &motions, map<st
 	enterprise[5].get_transform().rotate(vec3(0.0f, 0.0f, half_pi<float>() / 3.0f));
 	enterprise[6].get_transform().rotate(vec3(0.0f, 0.0f, -pi<float>() / 3.0f));
 	enterprise[6].get_transform().position = vec3(2.5f, -1.5f, 0.0f);
-	// Nacelle light domes
-	motions[0].get_transform().position = enterprise[0].get_transform().position - vec3(3.0f, -0.5f, 6.75f);
-	motions[1].get_transform().position = enterprise[0].get_transform().position - vec3(-3.0f, -0.5f, 6.75f);
+	// Nacelle light domes (relative to the connection in the scene graph)
+	motions[0].get_transform().position = vec3(-3.0f, 3.0f, -2.25f);
+	motions[1].get_transform().position = vec3(3.0f, 3.0f, -2.25f);
 
 	// SET MATERIALS
 	for (int i = 0; i < enterprise.size(); i++)
@@ -83,16 +86,17 @@ void load_enterprise(array<mesh, 7> &enterprise, array<mesh, 2> &motions, map<st
 	// SHADERS
 	// Load in shaders for enterprise
 	effects["ship_eff"].add_shader("shaders/enterprise.vert", GL_VERTEX_SHADER);
-	vector<string> ship_eff_frag_shaders{ "shaders/enterprise.frag", "shaders/part_spot.frag", "shaders/part_point.frag", "shaders/part_shadow.frag", "shaders/part_normal_map.frag" };
+	vector<string> ship_eff_frag_shaders{ "shaders/enterprise.frag", "shaders/part_spot.frag", "shaders/part_point.frag", "shaders/part_shadow.frag", "shaders/part_cluster.frag", "shaders/part_normal_map.frag" };
 	effects["ship_eff"].add_shader(ship_eff_frag_shaders, GL_FRAGMENT_SHADER);
 	effects["ship_eff"].build();
 }
 
 // Load Rama
-void load_rama(mesh &rama, array<mesh, 6> &rama_terrain, map<string, texture> &textures, array<texture, 4> &terrain_texs, map<string, texture> &normal_maps, map<string, effect> &effects)
+void load_rama(mesh &rama, array<mesh, 6> &rama_terrain, map<string, texture> &textures, array<texture, 4> &terrain_texs, map<string, texture> &normal_maps, map<string, effect> &effects, geometry_cache &geometries)
 {
 	//RAMA
-	rama = mesh(geometry_builder::create_cylinder(100, 100));
+	// Same cylinder as the Enterprise's saucer
+	rama = mesh(cached_cylinder(geometries, 100, 100));
 
 	// TRANSFORM
 	rama.get_transform().scale = vec3(20.0f, 40.0f, 20.0f);
@@ -117,12 +121,12 @@ void load_rama(mesh &rama, array<mesh, 6> &rama_terrain, map<string, texture> &t
 	// SHADERS
 	// Load in shaders for rama
 	effects["inside_eff"].add_shader("shaders/sun_shader.vert", GL_VERTEX_SHADER);
-	vector<string> inside_eff_frag_shaders{ "shaders/inside.frag", "shaders/part_spot.frag", "shaders/part_point.frag", "shaders/part_shadow.frag", "shaders/part_normal_map.frag", "shaders/part_fog.frag" };
+	vector<string> inside_eff_frag_shaders{ "shaders/inside.frag", "shaders/part_spot.frag", "shaders/part_point.frag", "shaders/part_shadow.frag", "shaders/part_cluster.frag", "shaders/part_normal_map.frag", "shaders/part_fog.frag" };
 	effects["inside_eff"].add_shader(inside_eff_frag_shaders, GL_FRAGMENT_SHADER);
 	effects["inside_eff"].build();
 
 	effects["outside_eff"].add_shader("shaders/planet_shader.vert", GL_VERTEX_SHADER);
-	vector<string> outside_eff_frag_shaders{ "shaders/blend.frag", "shaders/part_spot.frag", "shaders/part_point.frag", "shaders/part_shadow.frag", "shaders/part_normal_map.frag" };
+	vector<string> outside_eff_frag_shaders{ "shaders/blend.frag", "shaders/part_spot.frag", "shaders/part_point.frag", "shaders/part_shadow.frag", "shaders/part_cluster.frag", "shaders/part_normal_map.frag" };
 	effects["outside_eff"].add_shader(outside_eff_frag_shaders, GL_FRAGMENT_SHADER);
 	effects["outside_eff"].build();
 }
@@ -130,10 +134,8 @@ void load_rama(mesh &rama, array<mesh, 6> &rama_terrain, map<string, texture> &t
 // User controlled motion of Enterprise
 void move_enterprise(array<mesh, 7> &enterprise, array<mesh, 2> &motions, vec3 engage, float delta_time)
 {
-	// Move ship by "engage" vector
+	// Move ship by "engage" vector - the domes follow in the scene graph
 	enterprise[0].get_transform().translate(engage);
-	motions[0].get_transform().translate(engage);
-	motions[1].get_transform().translate(engage);
 	// Spin nacelle domes
 	motions[0].get_transform().rotate(vec3(0.0f, 0.0f, 10.0f * delta_time));
 	motions[1].get_transform().rotate(vec3(0.0f, 0.0f, 10.0f * delta_time));
@@ -144,4 +146,38 @@ void spin_rama(mesh &rama, mesh &terrain, float delta_time)
 {
 	// Rotate the outside
 	rama.get_transform().rotate(vec3(0.0f, -radians(0.1f + delta_time), 0.0f));
-}
\ No newline at end of file
+}
+
+// Can the camera see into Rama - from inside the hull, or through
+// one of its open ends while looking in from beyond it with the end
+// in view. Rama is a cylinder along its y axis
+bool rama_interior_visible(const mesh &rama, const mat4 &world, const vec3 &cam_pos, const array<vec4, 6> &planes)
+{
+	vec3 min_point = rama.get_minimal();
+	vec3 max_point = rama.get_maximal();
+	vec3 centre = (min_point + max_point) * 0.5f;
+	vec3 half_size = (max_point - min_point) * 0.5f;
+	// Camera in Rama's space
+	vec3 local = vec3(inverse(world) * vec4(cam_pos, 1.0f));
+	// Inside the hull
+	vec2 across = vec2(local.x - centre.x, local.z - centre.z) / vec2(half_size.x, half_size.z);
+	if (length(across) <= 1.0f && abs(local.y - centre.y) <= half_size.y)
+		return true;
+	// World radius of an end
+	float scale = std::max(length(vec3(world[0])), length(vec3(world[2])));
+	float radius = std::max(half_size.x, half_size.z) * scale;
+	for (float side = -1.0f; side <= 1.0f; side += 2.0f)
+	{
+		// Only looking in from beyond an end shows the inside
+		if ((local.y - centre.y) * side <= half_size.y)
+			continue;
+		// The end must be in view
+		vec3 portal = vec3(world * vec4(centre + vec3(0.0f, side * half_size.y, 0.0f), 1.0f));
+		bool in_view = true;
+		for (auto &p : planes)
+			in_view = in_view && dot(vec3(p), portal) + p.w + radius >= 0.0f;
+		if (in_view)
+			return true;
+	}
+	return false;
+}
@@ -0,0 +1,116 @@
+// transform_cache.h - Header file containing the per-frame
+// transform cache
+// Every object owns a slot. Once a frame the world matrices are
+// written in, then the normal and camera MVP matrices of every slot
+// are computed in one batch so the main pass only reads them. The
+// light MVPs are batched the same way for each shadow tile
+// Last modified - 18/10/2026
+
+#pragma once
+
+#include <glm\glm.hpp>
+#include <graphics_framework.h>
+
+// Use SSE for the batch multiply where the compiler provides it
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define TRANSFORM_CACHE_SSE
+#include <xmmintrin.h>
+#endif
+
+using namespace std;
+using namespace graphics_framework;
+using namespace glm;
+
+// Transform matrices stored structure-of-arrays, indexed by slot
+struct transform_cache
+{
+	// World matrix - written by the scene each frame
+	vector<mat4> world;
+	// Normal matrix
+	vector<mat3> normal;
+	// Camera model view projection
+	vector<mat4> mvp;
+	// Light model view projection of the shadow tile being rendered
+	vector<mat4> light_mvp;
+};
+
+// Reserve a slot for an object, returns the slot index
+unsigned int add_transform(transform_cache &cache)
+{
+	unsigned int slot = static_cast<unsigned int>(cache.world.size());
+	cache.world.push_back(mat4(1.0f));
+	cache.normal.push_back(mat3(1.0f));
+	cache.mvp.push_back(mat4(1.0f));
+	cache.light_mvp.push_back(mat4(1.0f));
+	return slot;
+}
+
+// Multiply every matrix in src by A, writing the results to dst
+void batch_transform(const mat4 &A, const mat4 *src, mat4 *dst, size_t count)
+{
+#ifdef TRANSFORM_CACHE_SSE
+	// Keep the columns of A in registers for the whole batch
+	const float *a = value_ptr(A);
+	const __m128 a0 = _mm_loadu_ps(a);
+	const __m128 a1 = _mm_loadu_ps(a + 4);
+	const __m128 a2 = _mm_loadu_ps(a + 8);
+	const __m128 a3 = _mm_loadu_ps(a + 12);
+	for (size_t i = 0; i < count; ++i)
+	{
+		const float *b = value_ptr(src[i]);
+		float *c = value_ptr(dst[i]);
+		// Each result column is A's columns weighted by a column of B
+		for (int j = 0; j < 16; j += 4)
+		{
+			__m128 col = _mm_mul_ps(a0, _mm_set1_ps(b[j]));
+			col = _mm_add_ps(col, _mm_mul_ps(a1, _mm_set1_ps(b[j + 1])));
+			col = _mm_add_ps(col, _mm_mul_ps(a2, _mm_set1_ps(b[j + 2])));
+			col = _mm_add_ps(col, _mm_mul_ps(a3, _mm_set1_ps(b[j + 3])));
+			_mm_storeu_ps(c + j, col);
+		}
+	}
+#else
+	for (size_t i = 0; i < count; ++i)
+		dst[i] = A * src[i];
+#endif
+}
+
+// Compute the normal matrix of every world matrix
+// Uses the cofactor matrix (inverse transpose up to scale) with
+// each column normalised, which gives the rotation of a scaled
+// transform like transform::get_normal_matrix
+void batch_normal(const mat4 *src, mat3 *dst, size_t count)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		mat3 m(src[i]);
+		mat3 n(cross(m[1], m[2]), cross(m[2], m[0]), cross(m[0], m[1]));
+		for (int c = 0; c < 3; ++c)
+		{
+			// Objects shrunk to nothing have no normal
+			float len = length(n[c]);
+			if (len > 0.0f)
+				n[c] /= len;
+		}
+		dst[i] = n;
+	}
+}
+
+// Compute the normal and MVP matrices for every slot
+void update_transform_cache(transform_cache &cache, const mat4 &PV)
+{
+	size_t count = cache.world.size();
+	if (count == 0)
+		return;
+	batch_transform(PV, &cache.world[0], &cache.mvp[0], count);
+	batch_normal(&cache.world[0], &cache.normal[0], count);
+}
+
+// Compute the light MVP of every slot for one light
+void update_light_transforms(transform_cache &cache, const mat4 &LightPV)
+{
+	size_t count = cache.world.size();
+	if (count == 0)
+		return;
+	batch_transform(LightPV, &cache.world[0], &cache.light_mvp[0], count);
+}
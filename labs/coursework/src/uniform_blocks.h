@@ -0,0 +1,146 @@
+// uniform_blocks.h - Header file containing the shared uniform blocks
+// The camera, fog, light and shadow data every effect reads is
+// uploaded once a frame into std140 uniform buffers instead of
+// being set on each effect, and the lights themselves into std430
+// storage buffers (see clusters.h). The structs here mirror the
+// block declarations in the shaders and must be kept in step with
+// them
+// Last modified - 18/10/2026
+
+#pragma once
+
+#include <glm\glm.hpp>
+#include <graphics_framework.h>
+#include <cstddef>
+
+using namespace std;
+using namespace graphics_framework;
+using namespace glm;
+
+// Block bindings and fixed texture units (match the shaders)
+#define FRAME_DATA_BINDING 0
+#define LIGHT_DATA_BINDING 1
+#define SHADOW_DATA_BINDING 2
+#define SHADOW_MAP_UNIT 7
+#define CASCADE_MAP_UNIT 8
+#define OMNI_MAP_UNIT 9
+#define MOMENTS_MAP_UNIT 10
+
+// Types of fog
+#define FOG_LINEAR 0
+#define FOG_EXP 1
+#define FOG_EXP2 2
+
+// Lights at the start of a pass that can have shadows
+#define MAX_POINT_LIGHTS 4
+#define MAX_SPOT_LIGHTS 4
+// Largest number of shadow cascades
+#define MAX_CASCADES 4
+
+// std430 point_light - 48 bytes
+struct point_light_std430
+{
+	vec4 light_colour;
+	vec3 position;
+	float constant;
+	float linear;
+	float quadratic;
+	// Distance the light reaches, for binning into clusters
+	float range;
+	float pad;
+};
+
+// std430 spot_light - 64 bytes
+struct spot_light_std430
+{
+	vec4 light_colour;
+	vec3 position;
+	float pad;
+	vec3 direction;
+	float constant;
+	float linear;
+	float quadratic;
+	float power;
+	float range;
+};
+
+// std140 frame_data block - camera and fog, binding 0
+struct frame_data_std140
+{
+	vec3 eye_pos;
+	int fog_type;
+	vec4 fog_colour;
+	float fog_start;
+	float fog_end;
+	float fog_density;
+	float pad;
+};
+
+// std140 light_data block - the light counts of a pass and the
+// camera its clusters are built for, binding 1
+struct light_data_std140
+{
+	mat4 V;
+	mat4 inverse_P;
+	ivec4 cluster_dims;
+	// Screen width and height, camera near and far planes
+	vec4 cluster_params;
+	int point_count;
+	int spot_count;
+	int pad[2];
+};
+
+// std140 shadow_data block - shadows of a pass's lights, binding 2
+// The atlas fills the tiles, the cascades fill their matrices, the
+// point light's cube map its light and the filter the rest
+struct shadow_data_std140
+{
+	mat4 shadow_matrices[MAX_SPOT_LIGHTS];
+	vec4 shadow_rects[MAX_SPOT_LIGHTS];
+	mat4 cascade_matrices[MAX_CASCADES];
+	int cascade_spot;
+	int cascade_count;
+	int omni_point;
+	int pad;
+	vec4 omni_light;
+	int filter_mode;
+	float filter_exponent;
+	float light_near;
+	float light_far;
+};
+
+// The buffers are filled with a straight copy of these structs
+static_assert(sizeof(point_light_std430) == 48, "point_light_std430 does not match std430");
+static_assert(sizeof(spot_light_std430) == 64, "spot_light_std430 does not match std430");
+static_assert(sizeof(frame_data_std140) == 48, "frame_data_std140 does not match std140");
+static_assert(sizeof(light_data_std140) == 176, "light_data_std140 does not match std140");
+static_assert(sizeof(shadow_data_std140) == 624, "shadow_data_std140 does not match std140");
+
+// Create a uniform buffer big enough for size bytes
+GLuint create_uniform_buffer(GLsizeiptr size)
+{
+	GLuint buffer;
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+	glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	return buffer;
+}
+
+// Upload the camera and fog data for this frame
+void update_frame_data(GLuint buffer, vec3 cam_pos)
+{
+	frame_data_std140 data;
+	// Eye position of the active camera
+	data.eye_pos = cam_pos;
+	// Fog inside Rama and over the terrain
+	data.fog_colour = vec4(0.412f, 1.0f, 0.996f, 1.0f);
+	data.fog_start = 5.0f;
+	data.fog_end = 100.0f;
+	data.fog_density = 0.04f;
+	data.fog_type = FOG_EXP2;
+	data.pad = 0.0f;
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(data), &data);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
@@ -0,0 +1,149 @@
+// uniform_table.h - Header file containing the uniform tables
+// The active uniforms of each effect are found once, after it is
+// built, through the program interface queries. Call sites then
+// hold typed handles to the locations they need rather than
+// looking them up by name every draw
+// Define UNIFORM_TABLE_DEBUG (on by default in debug builds) to
+// report any uniform that is set but not active in its effect
+// Last modified - 18/10/2026
+
+#pragma once
+
+#include <glm\glm.hpp>
+#include <graphics_framework.h>
+#include <iostream>
+#include <set>
+#include <unordered_map>
+
+#if defined(_DEBUG) && !defined(UNIFORM_TABLE_DEBUG)
+#define UNIFORM_TABLE_DEBUG
+#endif
+
+using namespace std;
+using namespace graphics_framework;
+using namespace glm;
+
+// Active uniforms of an effect and their locations
+struct uniform_table
+{
+	GLuint program = 0;
+	unordered_map<string, GLint> locations;
+};
+
+// Location of a uniform of type T, -1 if it is not active
+template <typename T> struct uniform_handle
+{
+	GLint location = -1;
+#ifdef UNIFORM_TABLE_DEBUG
+	// Kept to report handles that are set but never active
+	GLuint program = 0;
+	string name;
+#endif
+};
+
+// Find every active uniform of a built effect
+uniform_table build_uniform_table(effect &eff)
+{
+	uniform_table table;
+	table.program = eff.get_program();
+	GLint count = 0;
+	GLint max_length = 0;
+	glGetProgramInterfaceiv(table.program, GL_UNIFORM, GL_ACTIVE_RESOURCES, &count);
+	glGetProgramInterfaceiv(table.program, GL_UNIFORM, GL_MAX_NAME_LENGTH, &max_length);
+	vector<char> buffer(std::max(max_length, 1));
+	const GLenum props[] = { GL_LOCATION, GL_ARRAY_SIZE };
+	for (GLint i = 0; i < count; ++i)
+	{
+		GLint values[2];
+		glGetProgramResourceiv(table.program, GL_UNIFORM, i, 2, props, 2, nullptr, values);
+		// Members of uniform blocks have no location
+		if (values[0] < 0)
+			continue;
+		glGetProgramResourceName(table.program, GL_UNIFORM, i, max_length, nullptr, &buffer[0]);
+		string name(&buffer[0]);
+		table.locations[name] = values[0];
+		// Arrays are reported as name[0], add the bare name and
+		// every element so they can be found either way
+		auto bracket = name.rfind("[0]");
+		if (bracket != string::npos && bracket + 3 == name.size())
+		{
+			string base = name.substr(0, bracket);
+			table.locations[base] = values[0];
+			for (GLint j = 1; j < values[1]; ++j)
+			{
+				string element = base + "[" + to_string(j) + "]";
+				table.locations[element] = glGetUniformLocation(table.program, element.c_str());
+			}
+		}
+	}
+	return table;
+}
+
+// Build a table for every effect in a map
+void build_uniform_tables(map<string, effect> &effects, map<string, uniform_table> &tables)
+{
+	for (auto &e : effects)
+		tables[e.first] = build_uniform_table(e.second);
+}
+
+// Resolve a handle to a uniform, inactive uniforms give location -1
+template <typename T> uniform_handle<T> get_handle(const uniform_table &table, const string &name)
+{
+	uniform_handle<T> handle;
+	auto found = table.locations.find(name);
+	if (found != table.locations.end())
+		handle.location = found->second;
+#ifdef UNIFORM_TABLE_DEBUG
+	handle.program = table.program;
+	handle.name = name;
+#endif
+	return handle;
+}
+
+// Report a uniform that is set but not active, once per effect
+template <typename T> bool check_handle(const uniform_handle<T> &handle)
+{
+#ifdef UNIFORM_TABLE_DEBUG
+	static set<pair<GLuint, string>> reported;
+	if (handle.location < 0 && reported.insert(make_pair(handle.program, handle.name)).second)
+		cerr << "Uniform " << handle.name << " is set but not active in program " << handle.program << endl;
+#endif
+	return handle.location >= 0;
+}
+
+// Set a uniform through its handle
+void set_uniform(const uniform_handle<mat4> &handle, const mat4 &value)
+{
+	if (check_handle(handle))
+		glUniformMatrix4fv(handle.location, 1, GL_FALSE, value_ptr(value));
+}
+
+void set_uniform(const uniform_handle<mat3> &handle, const mat3 &value)
+{
+	if (check_handle(handle))
+		glUniformMatrix3fv(handle.location, 1, GL_FALSE, value_ptr(value));
+}
+
+void set_uniform(const uniform_handle<vec4> &handle, const vec4 &value)
+{
+	if (check_handle(handle))
+		glUniform4fv(handle.location, 1, value_ptr(value));
+}
+
+void set_uniform(const uniform_handle<vec3> &handle, const vec3 &value)
+{
+	if (check_handle(handle))
+		glUniform3fv(handle.location, 1, value_ptr(value));
+}
+
+void set_uniform(const uniform_handle<float> &handle, float value)
+{
+	if (check_handle(handle))
+		glUniform1f(handle.location, value);
+}
+
+void set_uniform(const uniform_handle<int> &handle, int value)
+{
+	if (check_handle(handle))
+		glUniform1i(handle.location, value);
+}
@@ -0,0 +1,141 @@
+// software_occlusion_test.cpp - Headless test of the CPU occlusion buffer
+// Draws each occluder shape into the masked depth buffer and checks
+// spheres known to be hidden and known to be visible, including
+// over a terrain's heightfield, then checks
+// the AVX2 tile coverage against the scalar one bit for bit. Only
+// glm is needed, no window or GL context
+// Last modified - 18/10/2026
+
+#include <glm\glm.hpp>
+#include <glm\gtc\matrix_transform.hpp>
+#include <cstdio>
+#include <random>
+#include "../src/software_occlusion.h"
+
+using namespace std;
+using namespace glm;
+
+// Number of checks that failed
+int failures = 0;
+
+// Report a check
+void check(bool passed, const char *shape, const char *what)
+{
+	if (!passed)
+		++failures;
+	printf("%s %s: %s\n", passed ? "PASS" : "FAIL", shape, what);
+}
+
+// Draw one shape three units across at the origin and test spheres
+// behind, in front of and beside it
+void test_shape(software_occlusion &sw, int shape, const char *name)
+{
+	// Camera 30 units back along z, twice as wide as high like the buffer
+	mat4 P = frustum(-0.2f, 0.2f, -0.1f, 0.1f, 0.5f, 100.0f);
+	mat4 V = lookAt(vec3(0.0f, 0.0f, 30.0f), vec3(0.0f), vec3(0.0f, 1.0f, 0.0f));
+	clear_software_occlusion(sw, P * V);
+	occluder o = { shape, 0, vec3(-1.0f), vec3(1.0f) };
+	render_occluder(sw, o, scale(mat4(1.0f), vec3(3.0f)));
+	check(sw.triangles > 0, name, "shape reaches the buffer");
+	// Small sphere straight behind
+	check(!test_occlusion_sphere(sw, vec3(0.0f, 0.0f, -10.0f), 0.5f), name, "sphere behind is occluded");
+	// Behind and a little off centre, still well inside the outline
+	check(!test_occlusion_sphere(sw, vec3(1.0f, 0.5f, -10.0f), 0.5f), name, "sphere behind off centre is occluded");
+	// In front of the occluder
+	check(test_occlusion_sphere(sw, vec3(0.0f, 0.0f, 10.0f), 0.5f), name, "sphere in front is visible");
+	// Behind but clear of the outline
+	check(test_occlusion_sphere(sw, vec3(12.0f, 0.0f, -10.0f), 0.5f), name, "sphere beside is visible");
+	// Behind and straddling the outline, which reaches about 4 to
+	// 4.5 units across at that depth depending on the shape
+	check(test_occlusion_sphere(sw, vec3(4.5f, 0.0f, -10.0f), 1.0f), name, "sphere across the edge is visible");
+}
+
+// A valley 12 units across between plateaus 10 units high, as a
+// terrain's vertices half a unit apart. Spheres down in the valley
+// must stay visible, ones under a plateau are hidden
+void test_heightfield(software_occlusion &sw)
+{
+	vector<vec3> positions;
+	for (float x = -24.0f; x <= 24.0f; x += 0.5f)
+		for (float z = -8.0f; z <= 8.0f; z += 0.5f)
+			positions.push_back(vec3(x, abs(x) < 6.0f ? 0.0f : 10.0f, z));
+	occluder o = create_heightfield_occluder(0, positions, 24, 8);
+	mat4 P = frustum(-0.2f, 0.2f, -0.1f, 0.1f, 0.5f, 100.0f);
+	// Looking straight down on the valley
+	clear_software_occlusion(sw, P * lookAt(vec3(0.0f, 40.0f, 0.0f), vec3(0.0f), vec3(0.0f, 0.0f, -1.0f)));
+	render_occluder(sw, o, mat4(1.0f));
+	check(sw.triangles > 0, "heightfield", "shape reaches the buffer");
+	check(test_occlusion_sphere(sw, vec3(0.0f, 2.0f, 0.0f), 0.5f), "heightfield", "sphere above the valley is visible from above");
+	check(test_occlusion_sphere(sw, vec3(-4.0f, 1.0f, 2.0f), 0.5f), "heightfield", "sphere by the valley's side is visible from above");
+	// Looking along the valley from above its end
+	clear_software_occlusion(sw, P * lookAt(vec3(0.0f, 20.0f, 30.0f), vec3(0.0f), vec3(0.0f, 1.0f, 0.0f)));
+	render_occluder(sw, o, mat4(1.0f));
+	check(test_occlusion_sphere(sw, vec3(0.0f, 2.0f, 0.0f), 0.5f), "heightfield", "sphere above the valley is visible at an angle");
+	// Looking down on a plateau
+	clear_software_occlusion(sw, P * lookAt(vec3(16.0f, 40.0f, 0.0f), vec3(16.0f, 0.0f, 0.0f), vec3(0.0f, 0.0f, -1.0f)));
+	render_occluder(sw, o, mat4(1.0f));
+	check(!test_occlusion_sphere(sw, vec3(16.0f, 5.0f, 0.0f), 0.5f), "heightfield", "sphere under the plateau is occluded");
+	// From underneath the terrain hides nothing
+	clear_software_occlusion(sw, P * lookAt(vec3(16.0f, -30.0f, 0.0f), vec3(16.0f, 0.0f, 0.0f), vec3(0.0f, 0.0f, -1.0f)));
+	render_occluder(sw, o, mat4(1.0f));
+	check(test_occlusion_sphere(sw, vec3(16.0f, 15.0f, 0.0f), 0.5f), "heightfield", "sphere above seen from below is visible");
+}
+
+// Random triangles around a tile must cover the same pixels on
+// both paths
+void test_coverage_paths()
+{
+#if defined(SOFTWARE_OCCLUSION_AVX2)
+	mt19937 rand(8116);
+	uniform_real_distribution<float> position(-48.0f, 80.0f);
+	int mismatches = 0;
+	for (int i = 0; i < 100000; ++i)
+	{
+		vec3 v[3];
+		for (auto &p : v)
+			p = vec3(position(rand), position(rand) * 0.25f, 0.0f);
+		// Some edges exactly along a row or a column
+		if (i % 7 == 0)
+			v[1].y = v[0].y;
+		if (i % 11 == 0)
+			v[2].x = v[1].x;
+		vec3 edges[3];
+		for (int e = 0; e < 3; ++e)
+		{
+			const vec3 &p = v[e];
+			const vec3 &q = v[(e + 1) % 3];
+			float a = -(q.y - p.y);
+			float b = q.x - p.x;
+			edges[e] = vec3(a, b, -(a * p.x + b * p.y));
+		}
+		uint32_t scalar[OCCLUSION_TILE_HEIGHT];
+		uint32_t avx2[OCCLUSION_TILE_HEIGHT];
+		tile_coverage_scalar(edges, scalar);
+		tile_coverage_avx2(edges, avx2);
+		for (int r = 0; r < OCCLUSION_TILE_HEIGHT; ++r)
+		{
+			if (scalar[r] != avx2[r])
+			{
+				++mismatches;
+				break;
+			}
+		}
+	}
+	check(mismatches == 0, "coverage", "scalar and AVX2 paths match on 100000 triangles");
+#else
+	printf("SKIP coverage: built without AVX2 (COURSEWORK_AVX2)\n");
+#endif
+}
+
+int main()
+{
+	software_occlusion sw;
+	create_software_occlusion(sw);
+	test_shape(sw, OCCLUDER_SPHERE, "sphere");
+	test_shape(sw, OCCLUDER_TUBE, "tube");
+	test_shape(sw, OCCLUDER_BOX, "box");
+	test_heightfield(sw);
+	test_coverage_paths();
+	printf("%d failed\n", failures);
+	return failures == 0 ? 0 : 1;
+}